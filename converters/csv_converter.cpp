@@ -0,0 +1,202 @@
+/*
+ * Streaming CSV to binary matrix (.ssvb) converter, see MatrixHeader in src/matrix.cpp.
+ * Does what csv_ssv_converter.py does, in bounded memory: the file is read in chunks
+ * and every chunk is parsed by the thread pool, split at line boundaries.
+ *
+ * g++ --std=c++17 -O2 -pthread csv_converter.cpp -o csv_converter
+ *
+ * MNIST as in csv_ssv_converter.py:
+ *   csv_converter mnist_test.csv mnist_test_input.ssvb --skip 1 --normalize 255
+ *   csv_converter mnist_test.csv mnist_test_output.ssvb --end 1 --onehot 10
+ *
+ * With CSV_CONVERTER_LIBRARY defined only convert() is compiled, for unit_tests/src/test_csv_converter.cpp
+ */
+#include "../src/matrix.cpp"
+#include "../src/threadpool.cpp"
+#include <charconv>
+#include <cstdio>
+#include <chrono>
+
+
+struct Options {
+	// Columns [skip, end) are kept, end < 0 keeps the rest of the row
+	long skip = 0;
+	long end = -1;
+	double normalization = 1;
+	// Every kept value becomes onehot columns with a 1 at the value, 0 disables
+	long onehot = 0;
+	bool single = false;
+	int threads = 0;
+	size_t chunkBytes = 16 << 20;
+};
+
+// Parses the lines in [begin, end) and appends their kept columns to out,
+// returns the number of rows and sets columns to the width of the last one
+template<typename T>
+size_t parseLines(const char* begin, const char* end, const Options& o, std::vector<T>& out, long& columns) {
+	size_t rows = 0;
+	while (begin < end) {
+		const char* lineEnd = std::find(begin, end, '\n');
+		const char* contentEnd = lineEnd;
+		while (contentEnd > begin && (contentEnd[-1] == '\r' || contentEnd[-1] == ' '))
+			contentEnd--;
+		// Empty lines, such as the one after a trailing newline, are skipped
+		if (contentEnd == begin) {
+			begin = lineEnd + 1;
+			continue;
+		}
+		size_t before = out.size();
+		long field = 0;
+		for (const char* p = begin; p <= lineEnd && p < end; field++) {
+			const char* fieldEnd = std::find(p, lineEnd, ',');
+			if (field >= o.skip && (o.end < 0 || field < o.end)) {
+				while (p < fieldEnd && (*p == ' ' || *p == '\t'))
+					p++;
+				double value;
+				auto [next, error] = std::from_chars(p, fieldEnd, value);
+				if (error != std::errc())
+					throw "Could not parse a number";
+				if (o.onehot) {
+					long k = (long) value;
+					if (k < 0 || k >= o.onehot)
+						throw "One-hot value out of range";
+					for (long c = 0; c < o.onehot; c++)
+						out.push_back(c == k ? 1 : 0);
+				} else {
+					out.push_back(value / o.normalization);
+				}
+			}
+			p = fieldEnd + 1;
+		}
+		if (out.size() > before) {
+			long width = out.size() - before;
+			if (columns >= 0 && width != columns)
+				throw "Rows have different numbers of columns";
+			columns = width;
+			rows++;
+		}
+		begin = lineEnd + 1;
+	}
+	return rows;
+}
+
+template<typename T>
+void convert(FILE* in, std::ofstream& out, const Options& o) {
+	ThreadPool pool(o.threads);
+	size_t parts = pool.size() * 4;
+	std::vector<char> buffer(o.chunkBytes);
+	std::vector<std::vector<T>> results(parts);
+	std::vector<size_t> partRows(parts);
+	std::vector<long> partColumns(parts);
+	size_t carry = 0, rows = 0;
+	long columns = -1;
+
+	MatrixHeader header(0, 0, sizeof(T));
+	out.write((const char*) &header, sizeof(header));
+
+	auto start = std::chrono::steady_clock::now();
+	bool eof = false;
+	while (!eof) {
+		size_t n = fread(buffer.data() + carry, 1, buffer.size() - carry, in);
+		eof = n < buffer.size() - carry;
+		size_t filled = carry + n;
+
+		// Only complete lines are parsed, the rest is carried over to the next chunk
+		size_t cut = filled;
+		if (!eof) {
+			while (cut > 0 && buffer[cut - 1] != '\n')
+				cut--;
+			if (cut == 0) {
+				// A line longer than the chunk
+				carry = filled;
+				buffer.resize(2 * buffer.size());
+				continue;
+			}
+		}
+
+		std::vector<size_t> bounds = {0};
+		for (size_t p = 1; p < parts; p++) {
+			size_t b = std::max(bounds.back(), cut * p / parts);
+			while (b < cut && b > 0 && buffer[b - 1] != '\n')
+				b++;
+			bounds.push_back(b);
+		}
+		bounds.push_back(cut);
+
+		pool.parallelFor(parts, [&] (size_t p) {
+			results[p].clear();
+			partColumns[p] = columns;
+			partRows[p] = parseLines(buffer.data() + bounds[p], buffer.data() + bounds[p + 1], o, results[p], partColumns[p]);
+		});
+		for (size_t p = 0; p < parts; p++) {
+			if (!partRows[p])
+				continue;
+			if (columns >= 0 && partColumns[p] != columns)
+				throw "Rows have different numbers of columns";
+			columns = partColumns[p];
+			rows += partRows[p];
+			out.write((const char*) results[p].data(), results[p].size() * sizeof(T));
+		}
+
+		carry = filled - cut;
+		std::copy(buffer.begin() + cut, buffer.begin() + filled, buffer.begin());
+	}
+
+	header.rows = rows;
+	header.columns = std::max(columns, 0L);
+	out.seekp(0);
+	out.write((const char*) &header, sizeof(header));
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Converted " << rows << " x " << header.columns << " in " << seconds << "s" << std::endl;
+}
+
+#ifndef CSV_CONVERTER_LIBRARY
+int main(int argc, char** argv) {
+	if (argc < 3) {
+		std::cerr << "Usage: " << argv[0] << " input.csv output.ssvb [--skip n] [--end n] [--normalize x] [--onehot classes] [--float] [--threads n] [--chunk MiB]" << std::endl;
+		return 1;
+	}
+	Options o;
+	for (int i = 3; i < argc; i++) {
+		std::string arg = argv[i];
+		bool value = i + 1 < argc;
+		if (arg == "--skip" && value)
+			o.skip = std::stol(argv[++i]);
+		else if (arg == "--end" && value)
+			o.end = std::stol(argv[++i]);
+		else if (arg == "--normalize" && value)
+			o.normalization = std::stod(argv[++i]);
+		else if (arg == "--onehot" && value)
+			o.onehot = std::stol(argv[++i]);
+		else if (arg == "--float")
+			o.single = true;
+		else if (arg == "--threads" && value)
+			o.threads = std::stoi(argv[++i]);
+		else if (arg == "--chunk" && value)
+			o.chunkBytes = std::stoul(argv[++i]) << 20;
+		else {
+			std::cerr << "Unknown option " << arg << std::endl;
+			return 1;
+		}
+	}
+
+	FILE* in = fopen(argv[1], "rb");
+	std::ofstream out(argv[2], std::ios::binary);
+	if (!in || !out) {
+		std::cerr << "Could not open " << (in ? argv[2] : argv[1]) << std::endl;
+		return 1;
+	}
+	try {
+		if (o.single)
+			convert<float>(in, out, o);
+		else
+			convert<double>(in, out, o);
+	} catch (const char* e) {
+		std::cerr << e << std::endl;
+		return 1;
+	}
+	fclose(in);
+	return 0;
+}
+#endif
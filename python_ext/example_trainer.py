@@ -1,14 +1,15 @@
 from keras.models import Sequential
 from keras.layers import Dense
 import numpy as np
-from gamenumpy import getboards
+from gamenumpy import game
 
-data = getboards(100)
+# Self-play positions from the perspective of the player who just moved, with that player's final result
+positions, outcomes = game.play_games(10000, "network.ssvn", epsilon=0.1)
 
 
 model = Sequential()
 model.add(Dense(32, input_dim=64, activation="sigmoid"))
 model.add(Dense(1, activation="linear"))
 
-model.compile()
-
+model.compile(optimizer="sgd", loss="mse")
+model.fit(positions.astype(np.float32), outcomes, batch_size=256, epochs=1)
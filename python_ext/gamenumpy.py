@@ -1,14 +1,13 @@
 import numpy as np
 import sys
-sys.path.append("./build/lib.linux-x86_64-3.7")
+import glob
+sys.path.extend(glob.glob("./build/lib.*"))
 import game
 
 def getboard():
-    boards = game.getBoard()
-    result = np.empty((len(boards), 8, 8))
-    for index, i in enumerate(boards):
-        result[index] = np.array(i).reshape((8,8))
-    return result
+    # Shape (61, 8, 8), the array shares memory with the extension
+    return game.getBoard()
 
 def getboards(num):
-    return np.array([getboard() for i in range(num)])
\ No newline at end of file
+    # Shape (num, 61, 8, 8), filled natively in one buffer
+    return game.getBoards(num)
@@ -1,28 +1,309 @@
+#define PY_SSIZE_T_CLEAN
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include <Python.h>
+#include <numpy/arrayobject.h>
 #include <vector>
-#include "matrix.cpp"
-#include "flippo.cpp"
+#include <cstring>
+#include "gamestate.cpp"
+#include "threadsafeplayer.cpp"
+#include "randomgenerator.cpp"
+#include "threadpool.cpp"
 
 
-static PyObject * vector_to_list(const std::vector<double> v) {
-    PyObject* result = PyList_New(0);
-    for (auto a : v) {
-        PyList_Append(result, PyFloat_FromDouble(a));
+// Arrays share memory with C++ objects instead of copying through Python lists:
+// either the array owns a heap vector through a capsule, or it is a view whose
+// base object keeps the owner alive.
+
+template<typename T>
+static void freeVector(PyObject* capsule) {
+    delete (std::vector<T>*) PyCapsule_GetPointer(capsule, NULL);
+}
+
+template<typename T>
+static PyObject* vectorToArray(std::vector<T>* data, int nd, npy_intp* dims, int type) {
+    PyObject* array = PyArray_SimpleNewFromData(nd, dims, type, data->data());
+    PyObject* capsule = PyCapsule_New(data, NULL, freeVector<T>);
+    if (!array || !capsule || PyArray_SetBaseObject((PyArrayObject*) array, capsule) < 0) {
+        Py_XDECREF(array);
+        if (capsule)
+            Py_DECREF(capsule);
+        else
+            delete data;
+        return NULL;
     }
-    return result;
+    return array;
 }
 
-static PyObject * game_getBoard(PyObject *self, PyObject *args) {
-    PyObject* result = PyList_New(0);
-    for (auto a : Flippo::createGame(1)) {
-        PyObject* matrix = vector_to_list(a.board.getData());
-        PyList_Append(result, matrix);
+static PyObject* viewArray(void* data, int nd, npy_intp* dims, int type, PyObject* owner) {
+    PyObject* array = PyArray_SimpleNewFromData(nd, dims, type, data);
+    if (!array)
+        return NULL;
+    Py_INCREF(owner);
+    if (PyArray_SetBaseObject((PyArrayObject*) array, owner) < 0) {
+        Py_DECREF(array);
+        return NULL;
+    }
+    return array;
+}
+
+// Every board of one random game, the start position included
+static void randomGame(double* out) {
+    GameState s;
+    memcpy(out, s.board.raw(), BOARD_SIZE * sizeof(double));
+    for (int k = 0; k < BOARD_SIZE - 4; k++) {
+        int c = s.getColour();
+        auto moves = s.validMoves(c);
+        auto [i, j] = moves[RandomGenerator::randomInt(0, moves.size() - 1)];
+        s.placePiece(i, j, c);
+        out += BOARD_SIZE;
+        memcpy(out, s.board.raw(), BOARD_SIZE * sizeof(double));
+    }
+}
+
+constexpr npy_intp gameLength = BOARD_SIZE - 3;
+
+static PyObject* game_getBoard(PyObject* self, PyObject* args) {
+    auto data = new std::vector<double>(gameLength * BOARD_SIZE);
+    randomGame(data->data());
+    npy_intp dims[3] = {gameLength, BOARD_HEIGHT, BOARD_WIDTH};
+    return vectorToArray(data, 3, dims, NPY_DOUBLE);
+}
+
+static PyObject* game_getBoards(PyObject* self, PyObject* args) {
+    Py_ssize_t n;
+    if (!PyArg_ParseTuple(args, "n", &n))
+        return NULL;
+    if (n < 0) {
+        PyErr_SetString(PyExc_ValueError, "n must not be negative");
+        return NULL;
+    }
+    auto data = new std::vector<double>(n * gameLength * BOARD_SIZE);
+    for (Py_ssize_t g = 0; g < n; g++)
+        randomGame(data->data() + g * gameLength * BOARD_SIZE);
+    npy_intp dims[4] = {n, gameLength, BOARD_HEIGHT, BOARD_WIDTH};
+    return vectorToArray(data, 4, dims, NPY_DOUBLE);
+}
+
+
+// game.Network(path) wraps a ThreadSafePlayer read from a .ssvn file
+typedef struct {
+    PyObject_HEAD
+    ThreadSafePlayer<>* player;
+} NetworkObject;
+
+static int Network_init(NetworkObject* self, PyObject* args, PyObject* kwds) {
+    const char* path;
+    if (!PyArg_ParseTuple(args, "s", &path))
+        return -1;
+    // weights and biases views, and evaluate without the GIL, point into the player
+    if (self->player) {
+        PyErr_SetString(PyExc_RuntimeError, "Network is already initialized");
+        return -1;
+    }
+    try {
+        self->player = new ThreadSafePlayer<>(std::string(path));
+    } catch (const char* e) {
+        PyErr_SetString(PyExc_IOError, e);
+        return -1;
+    }
+    return 0;
+}
+
+static void Network_dealloc(NetworkObject* self) {
+    delete self->player;
+    Py_TYPE(self)->tp_free((PyObject*) self);
+}
+
+static bool ready(NetworkObject* self) {
+    if (!self->player)
+        PyErr_SetString(PyExc_ValueError, "Network is not initialized");
+    return self->player;
+}
+
+// Views of the parameter matrices, writing to them changes the network
+static PyObject* matricesToList(NetworkObject* self, std::vector<Matrix<double>>& matrices) {
+    PyObject* result = PyList_New(matrices.size());
+    for (size_t i = 0; i < matrices.size(); i++) {
+        npy_intp dims[2] = {(npy_intp) matrices[i].rows, (npy_intp) matrices[i].columns};
+        PyObject* array = viewArray(matrices[i].raw(), 2, dims, NPY_DOUBLE, (PyObject*) self);
+        if (!array) {
+            Py_DECREF(result);
+            return NULL;
+        }
+        PyList_SET_ITEM(result, i, array);
     }
     return result;
 }
 
+static PyObject* Network_weights(NetworkObject* self, void*) {
+    if (!ready(self))
+        return NULL;
+    return matricesToList(self, self->player->weights);
+}
+
+static PyObject* Network_biases(NetworkObject* self, void*) {
+    if (!ready(self))
+        return NULL;
+    return matricesToList(self, self->player->biases);
+}
+
+static PyObject* Network_save(NetworkObject* self, PyObject* args) {
+    const char* path;
+    if (!ready(self) || !PyArg_ParseTuple(args, "s", &path))
+        return NULL;
+    try {
+        self->player->saveNetwork(path);
+    } catch (const char* e) {
+        PyErr_SetString(PyExc_IOError, e);
+        return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyGetSetDef NetworkGetSet[] = {
+    {"weights", (getter) Network_weights, NULL, "Weight matrices as views", NULL},
+    {"biases", (getter) Network_biases, NULL, "Bias vectors as views", NULL},
+    {NULL}
+};
+
+static PyMethodDef NetworkMethods[] = {
+    {"save", (PyCFunction) Network_save, METH_VARARGS, "Save as .ssvn"},
+    {NULL}
+};
+
+static PyTypeObject NetworkType = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+};
+
+
+// The batch entry points below release the GIL and run on a ThreadPool,
+// RandomGenerator is thread local so every worker has its own RNG
+
+constexpr int movesPerGame = BOARD_SIZE - 4;
+
+// Epsilon-greedy self-play, every position from the perspective of the player
+// who just moved, labelled with that player's final score / MAX_SCORE
+static void selfPlay(ThreadSafePlayer<>* net, const double epsilon, int8_t* positions, float* outcomes) {
+    GameState s;
+    int colours[movesPerGame];
+    for (int k = 0; k < movesPerGame; k++) {
+        int c = s.getColour();
+        if (RandomGenerator::randomDouble(0, 1) < epsilon) {
+            auto moves = s.validMoves(c);
+            auto [i, j] = moves[RandomGenerator::randomInt(0, moves.size() - 1)];
+            s.placePiece(i, j, c);
+        } else {
+            auto [i, j] = net->predictMove(s);
+            s.placePiece(i, j, c);
+        }
+        const double* board = s.board.raw();
+        for (int q = 0; q < BOARD_SIZE; q++)
+            positions[k * BOARD_SIZE + q] = c * board[q];
+        colours[k] = c;
+    }
+    for (int k = 0; k < movesPerGame; k++)
+        outcomes[k] = (float) (colours[k] * s.getScore() / MAX_SCORE);
+}
+
+static PyObject* game_play_games(PyObject* self, PyObject* args, PyObject* kwds) {
+    static const char* keywords[] = {"n", "net_path", "epsilon", "threads", NULL};
+    Py_ssize_t n;
+    const char* path;
+    double epsilon = 0.1;
+    int threads = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "ns|di", (char**) keywords, &n, &path, &epsilon, &threads))
+        return NULL;
+    if (n < 0) {
+        PyErr_SetString(PyExc_ValueError, "n must not be negative");
+        return NULL;
+    }
+
+    ThreadSafePlayer<>* net;
+    try {
+        net = new ThreadSafePlayer<>(std::string(path));
+    } catch (const char* e) {
+        PyErr_SetString(PyExc_IOError, e);
+        return NULL;
+    }
+
+    auto positions = new std::vector<int8_t>(n * movesPerGame * BOARD_SIZE);
+    auto outcomes = new std::vector<float>(n * movesPerGame);
+    Py_BEGIN_ALLOW_THREADS
+    {
+        ThreadPool pool(threads);
+        pool.parallelFor(n, [&] (size_t g) {
+            selfPlay(net, epsilon, positions->data() + g * movesPerGame * BOARD_SIZE, outcomes->data() + g * movesPerGame);
+        });
+    }
+    Py_END_ALLOW_THREADS
+    delete net;
+
+    npy_intp positionDims[2] = {n * movesPerGame, BOARD_SIZE};
+    npy_intp outcomeDims[1] = {n * movesPerGame};
+    PyObject* x = vectorToArray(positions, 2, positionDims, NPY_INT8);
+    PyObject* y = vectorToArray(outcomes, 1, outcomeDims, NPY_FLOAT32);
+    if (!x || !y) {
+        Py_XDECREF(x);
+        Py_XDECREF(y);
+        return NULL;
+    }
+    return Py_BuildValue("(NN)", x, y);
+}
+
+// Forward pass of a batch of boards, any shape (n, 64) or (n, 8, 8), in chunks over the threads
+static PyObject* game_evaluate(PyObject* self, PyObject* args, PyObject* kwds) {
+    static const char* keywords[] = {"net", "boards", "threads", NULL};
+    NetworkObject* network;
+    PyObject* boards;
+    int threads = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O|i", (char**) keywords, &NetworkType, &network, &boards, &threads))
+        return NULL;
+    if (!ready(network))
+        return NULL;
+
+    PyArrayObject* input = (PyArrayObject*) PyArray_FROMANY(boards, NPY_DOUBLE, 1, 3, NPY_ARRAY_IN_ARRAY);
+    if (!input)
+        return NULL;
+    ThreadSafePlayer<>* net = network->player;
+    npy_intp inputs = net->getInputSize();
+    npy_intp rows = PyArray_SIZE(input) / inputs;
+    if (rows * inputs != PyArray_SIZE(input)) {
+        Py_DECREF(input);
+        PyErr_SetString(PyExc_ValueError, "Boards do not match the network input size");
+        return NULL;
+    }
+
+    npy_intp outputs = net->getOutputSize();
+    auto result = new std::vector<float>(rows * outputs);
+    const double* data = (const double*) PyArray_DATA(input);
+    constexpr npy_intp chunk = 1024;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        ThreadPool pool(threads);
+        pool.parallelFor((rows + chunk - 1) / chunk, [&] (size_t c) {
+            npy_intp first = c * chunk, size = std::min(chunk, rows - first);
+            Matrix<double> X(size, inputs);
+            std::copy(data + first * inputs, data + (first + size) * inputs, X.raw());
+            auto w = net->workspace(size);
+            const Matrix<double>& out = net->forward(X, w);
+            std::copy(out.raw(), out.raw() + out.size(), result->data() + first * outputs);
+        });
+    }
+    Py_END_ALLOW_THREADS
+    Py_DECREF(input);
+
+    npy_intp dims[2] = {rows, outputs};
+    return vectorToArray(result, 2, dims, NPY_FLOAT32);
+}
+
+
 static PyMethodDef GameMethods[] = {
-    {"getBoard", game_getBoard, METH_VARARGS, "Get list of boards"},
+    {"getBoard", game_getBoard, METH_VARARGS, "Boards of one random game, shape (61, 8, 8)"},
+    {"getBoards", game_getBoards, METH_VARARGS, "Boards of n random games, shape (n, 61, 8, 8)"},
+    {"play_games", (PyCFunction) game_play_games, METH_VARARGS | METH_KEYWORDS,
+        "play_games(n, net_path, epsilon=0.1, threads=0) -> (positions int8 (n*60, 64), outcomes float32 (n*60,))"},
+    {"evaluate", (PyCFunction) game_evaluate, METH_VARARGS | METH_KEYWORDS,
+        "evaluate(net, boards, threads=0) -> float32 (n, outputs)"},
     {NULL, NULL, 0, NULL}
 };
 
@@ -35,5 +316,28 @@ static struct PyModuleDef game = {
 };
 
 PyMODINIT_FUNC PyInit_game(void) {
-    return PyModule_Create(&game);
-}
\ No newline at end of file
+    import_array();
+
+    NetworkType.tp_name = "game.Network";
+    NetworkType.tp_basicsize = sizeof(NetworkObject);
+    NetworkType.tp_flags = Py_TPFLAGS_DEFAULT;
+    NetworkType.tp_doc = "Neural network read from a .ssvn file";
+    NetworkType.tp_new = PyType_GenericNew;
+    NetworkType.tp_init = (initproc) Network_init;
+    NetworkType.tp_dealloc = (destructor) Network_dealloc;
+    NetworkType.tp_methods = NetworkMethods;
+    NetworkType.tp_getset = NetworkGetSet;
+    if (PyType_Ready(&NetworkType) < 0)
+        return NULL;
+
+    PyObject* module = PyModule_Create(&game);
+    if (!module)
+        return NULL;
+    Py_INCREF(&NetworkType);
+    if (PyModule_AddObject(module, "Network", (PyObject*) &NetworkType) < 0) {
+        Py_DECREF(&NetworkType);
+        Py_DECREF(module);
+        return NULL;
+    }
+    return module;
+}
@@ -2,8 +2,9 @@ import os
 from setuptools import setup, Extension
 import numpy as np
 
-module = Extension('game', sources=['main.cpp'], language='c++')
+module = Extension('game', sources=['main.cpp'], language='c++',
+    extra_compile_args=['--std=c++17', '-O2', '-pthread'], extra_link_args=['-pthread'])
 
-setup(name="game", ext_modules=[module], 
+setup(name="game", ext_modules=[module], install_requires=["numpy"],
     include_dirs = [np.get_include(), "../src/"]
-)
\ No newline at end of file
+)
@@ -3,6 +3,7 @@
 #include <functional>
 #include <cmath>
 #include <limits>
+#include <algorithm>
 
 template<typename T>
 class Function {
@@ -10,6 +11,19 @@ class Function {
 		virtual T function(const T x) const = 0;
 		virtual T derivative(const T x) const = 0;
 		virtual int getID() const = 0;
+
+		// Batch kernels, one virtual call per layer instead of per element
+		virtual void forward(const T* z, T* a, const size_t n) const {
+			for (size_t i = 0; i < n; i++)
+				a[i] = function(z[i]);
+		}
+
+		// delta *= f'(z)
+		virtual void backward(const T* z, T* delta, const size_t n) const {
+			for (size_t i = 0; i < n; i++)
+				delta[i] *= derivative(z[i]);
+		}
+
 		virtual ~Function() {}
 };
 
@@ -27,6 +41,12 @@ class Linear : public Function<T> {
 
 		int getID() const {return 1;};
 
+		void forward(const T* z, T* a, const size_t n) const {
+			std::copy(z, z + n, a);
+		}
+
+		void backward(const T* z, T* delta, const size_t n) const {}
+
 		~Linear() {}
 };
 
@@ -44,6 +64,18 @@ class Sigmoid : public Function<T> {
 
 		int getID() const {return 2;};
 
+		void forward(const T* z, T* a, const size_t n) const {
+			for (size_t i = 0; i < n; i++)
+				a[i] = 1 / (1 + std::exp(-z[i]));
+		}
+
+		void backward(const T* z, T* delta, const size_t n) const {
+			for (size_t i = 0; i < n; i++) {
+				T s = 1 / (1 + std::exp(-z[i]));
+				delta[i] *= s * (1 - s);
+			}
+		}
+
 		~Sigmoid() {}
 };
 
@@ -61,6 +93,13 @@ class TanH : public Function<T> {
 
 		int getID() const {return 3;};
 
+		void backward(const T* z, T* delta, const size_t n) const {
+			for (size_t i = 0; i < n; i++) {
+				T t = 2 / (1 + std::exp(-2*z[i])) - 1;
+				delta[i] *= 1 - t*t;
+			}
+		}
+
 		~TanH() {}
 };
 
@@ -0,0 +1,173 @@
+#ifndef ACTORLEARNER
+#define ACTORLEARNER
+#include "qlearner.cpp"
+#include "boundedqueue.cpp"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <iostream>
+
+
+// Double-buffered network parameters behind a sequence lock. Version v lives in
+// buffer v & 1, so the learner writes the buffer readers are not using. The sequence
+// is odd while a version is being written, readers retry only if the writer
+// started on their own buffer while they copied. Nobody waits on a mutex.
+class WeightSnapshot {
+
+	private:
+
+		size_t count;
+		std::unique_ptr<std::atomic<double>[]> buffers[2];
+		std::atomic<unsigned long> sequence;
+
+	public:
+
+		WeightSnapshot(const NeuralNetwork<double>& net) : count(net.parameterCount()), sequence(0) {
+			for (auto &b : buffers)
+				b.reset(new std::atomic<double>[count]);
+			publish(net);
+		}
+
+		// Single writer only
+		void publish(const NeuralNetwork<double>& net) {
+			std::vector<double> parameters(count);
+			net.getParameters(parameters.data());
+			unsigned long next = sequence.load(std::memory_order_relaxed) / 2 + 1;
+			sequence.store(2 * next - 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			std::atomic<double>* target = buffers[next & 1].get();
+			for (size_t i = 0; i < count; i++)
+				target[i].store(parameters[i], std::memory_order_relaxed);
+			sequence.store(2 * next, std::memory_order_release);
+		}
+
+		inline unsigned long version() const {
+			return sequence.load(std::memory_order_acquire) / 2;
+		}
+
+		// Returns the version that was read
+		unsigned long read(NeuralNetwork<double>& net, std::vector<double>& scratch) const {
+			scratch.resize(count);
+			while (true) {
+				unsigned long v = sequence.load(std::memory_order_acquire) / 2;
+				const std::atomic<double>* source = buffers[v & 1].get();
+				for (size_t i = 0; i < count; i++)
+					scratch[i] = source[i].load(std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_acquire);
+				// Writing version v + 2 into this buffer starts at sequence 2v + 3
+				if (sequence.load(std::memory_order_relaxed) < 2 * v + 3) {
+					net.setParameters(scratch.data());
+					return v;
+				}
+			}
+		}
+};
+
+
+// Self-play actor threads feed positions through a lock-free queue to one learner
+class ActorLearner {
+
+	private:
+
+		struct Sample {
+			Bitboard position;
+			float target;
+		};
+
+		QLearner* learner;
+		int numActors;
+		BoundedQueue<Sample> queue;
+		WeightSnapshot snapshot;
+		std::atomic<bool> stopping;
+
+		void actor(ThreadSafePlayer<>* local, double epsilon) {
+			std::vector<double> scratch;
+			unsigned long version = snapshot.read(*local, scratch);
+			while (!stopping.load(std::memory_order_relaxed)) {
+				if (snapshot.version() != version)
+					version = snapshot.read(*local, scratch);
+				QLearner::playGame(local, epsilon, learner->gamma, [this] (const Bitboard& b, double target) {
+					Sample s = {b, (float) target};
+					while (!queue.push(s)) {
+						if (stopping.load(std::memory_order_relaxed))
+							return;
+						actorStalls.fetch_add(1, std::memory_order_relaxed);
+						std::this_thread::yield();
+					}
+					actorSamples.fetch_add(1, std::memory_order_relaxed);
+				});
+				actorGames.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+	public:
+
+		// Statistics
+		std::atomic<long> actorGames;
+		std::atomic<long> actorSamples;
+		std::atomic<long> actorStalls;
+		long learnerBatches = 0;
+		long learnerSamples = 0;
+		double seconds = 0;
+
+		ActorLearner(QLearner* l, int actors = 0, size_t queueSize = 1 << 16) : learner(l), numActors(actors > 0 ? actors : std::max(1u, std::thread::hardware_concurrency() - 1)), queue(queueSize), snapshot(*l->approximator), stopping(false), actorGames(0), actorSamples(0), actorStalls(0) {}
+
+		// Runs for the given number of learner batches, publishing the weights every publishRate batches
+		void run(long batches, size_t batchSize, double eta, double epsilon, int publishRate = 10, bool verbose = false, int reportRate = 1000) {
+
+			// Every actor plays with its own copy, made before the learner starts changing the weights
+			stopping = false;
+			snapshot.publish(*learner->approximator);
+			std::vector<std::unique_ptr<ThreadSafePlayer<>>> locals;
+			std::vector<std::thread> actors;
+			for (int i = 0; i < numActors; i++) {
+				locals.emplace_back(new ThreadSafePlayer<>(*learner->approximator));
+				actors.emplace_back(&ActorLearner::actor, this, locals.back().get(), epsilon);
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			Sample s;
+			for (long b = 0; b < batches; ) {
+				while (queue.pop(s)) {
+					learner->addSample(s.position, s.target);
+					learnerSamples++;
+				}
+				if (learner->replaySize() < batchSize) {
+					std::this_thread::yield();
+					continue;
+				}
+				learner->trainBatch(batchSize, eta);
+				learnerBatches++;
+				b++;
+				if (b % publishRate == 0)
+					snapshot.publish(*learner->approximator);
+				if (verbose && b % reportRate == 0) {
+					seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+					report();
+				}
+			}
+			seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			stopping = true;
+			for (auto &a : actors)
+				a.join();
+		}
+
+		inline size_t queueDepth() const {
+			return queue.size();
+		}
+
+		void report() const {
+			double elapsed = seconds;
+			std::cout << "Actor games: " << actorGames << " Actor samples: " << actorSamples << " Stalls: " << actorStalls
+				<< " Learner batches: " << learnerBatches << " Learner samples: " << learnerSamples
+				<< " Queue depth: " << queueDepth() << "/" << queue.capacity();
+			if (elapsed > 0)
+				std::cout << " Actor samples/sec: " << actorSamples / elapsed << " Learner batches/sec: " << learnerBatches / elapsed;
+			std::cout << std::endl;
+		}
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef AFFINITY
+#define AFFINITY
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <sched.h>
+#include <pthread.h>
+
+
+// CPU and NUMA topology from sysfs, without depending on libnuma.
+// A machine without NUMA information is one node with every CPU.
+namespace Affinity {
+
+	// Parses a sysfs cpu list such as "0-3,8-11"
+	inline std::vector<int> parseList(const std::string &list) {
+		std::vector<int> result;
+		std::stringstream ss(list);
+		std::string range;
+		while (std::getline(ss, range, ',')) {
+			if (range.empty() || range == "\n")
+				continue;
+			size_t dash = range.find('-');
+			int first = std::stoi(range.substr(0, dash));
+			int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+			for (int c = first; c <= last; c++)
+				result.push_back(c);
+		}
+		return result;
+	}
+
+	inline std::vector<int> allCpus() {
+		std::vector<int> result;
+		int n = std::max(1u, std::thread::hardware_concurrency());
+		for (int c = 0; c < n; c++)
+			result.push_back(c);
+		return result;
+	}
+
+	inline int numaNodes() {
+		int n = 0;
+		while (std::ifstream("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist"))
+			n++;
+		return std::max(n, 1);
+	}
+
+	inline std::vector<int> nodeCpus(const int node) {
+		std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+		std::string list;
+		if (!file || !std::getline(file, list))
+			return allCpus();
+		std::vector<int> cpus = parseList(list);
+		return cpus.empty() ? allCpus() : cpus;
+	}
+
+	// Restrict the calling thread, threads it starts afterwards inherit the mask
+	inline bool pinThread(const std::vector<int> &cpus) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		for (int c : cpus)
+			CPU_SET(c, &set);
+		return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+	}
+
+	inline bool pinThread(const int cpu) {
+		return pinThread(std::vector<int>{cpu});
+	}
+
+	inline bool pinToNode(const int node) {
+		return pinThread(nodeCpus(node % numaNodes()));
+	}
+}
+
+#endif
@@ -0,0 +1,281 @@
+#ifndef ALLOCATIONS
+#define ALLOCATIONS
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#ifdef TRACK_ALLOCATION_SITES
+#include <execinfo.h>
+#include <cxxabi.h>
+#include <cstring>
+#endif
+
+
+// Heap traffic of the program, counted by replacing the global operator new and
+// delete when built with -DTRACK_ALLOCATIONS (make allocations). Without it every
+// count stays 0. -DTRACK_ALLOCATION_SITES also attributes allocations to their call
+// stacks, which is slow and meant for debug builds with -rdynamic.
+namespace Allocations {
+
+#ifdef TRACK_ALLOCATIONS
+	constexpr bool tracking = true;
+#else
+	constexpr bool tracking = false;
+#endif
+
+	struct Counts {
+		uint64_t allocations = 0;
+		uint64_t frees = 0;
+		uint64_t bytes = 0;
+
+		Counts operator-(const Counts& c) const {
+			return {allocations - c.allocations, frees - c.frees, bytes - c.bytes};
+		}
+	};
+
+	// Trivial, so the hooks can use it before the thread has run any constructor
+	inline thread_local Counts local;
+
+	struct Totals {
+		std::atomic<uint64_t> allocations;
+		std::atomic<uint64_t> frees;
+		std::atomic<uint64_t> bytes;
+	};
+
+	// Zero initialized before any allocation, since it is constant initialized
+	inline Totals totals = {{0}, {0}, {0}};
+
+	// Counts of the calling thread
+	inline Counts thisThread() {
+		return local;
+	}
+
+	// Counts of all threads together
+	inline Counts all() {
+		return {totals.allocations.load(std::memory_order_relaxed), totals.frees.load(std::memory_order_relaxed), totals.bytes.load(std::memory_order_relaxed)};
+	}
+
+	// What the calling thread allocated during the lifetime of a Scope
+	class Scope {
+
+		private:
+
+			Counts start;
+
+		public:
+
+			Scope() : start(local) {}
+
+			inline Counts counts() const {
+				return local - start;
+			}
+	};
+
+#ifdef TRACK_ALLOCATION_SITES
+	constexpr int depth = 16;
+	constexpr size_t siteSlots = 1 << 12;
+
+	struct Site {
+		std::atomic<uint64_t> key;
+		void* frames[depth];
+		int size;
+		std::atomic<uint64_t> allocations;
+		std::atomic<uint64_t> bytes;
+	};
+
+	inline Site sites[siteSlots];
+
+	// Set while a thread is inside backtrace or a report, which may allocate themselves
+	inline thread_local bool busy = false;
+
+	inline void recordSite(const size_t n) {
+		if (busy)
+			return;
+		busy = true;
+		void* frames[depth + 2];
+		// The first two frames are this function and the hook
+		int size = backtrace(frames, depth + 2) - 2;
+		uint64_t key = 1469598103934665603ull;
+		for (int f = 0; f < size; f++)
+			key = (key ^ (uint64_t) frames[f + 2]) * 1099511628211ull;
+		key |= 1;
+		for (size_t probe = 0; probe < siteSlots; probe++) {
+			Site& s = sites[(key + probe) & (siteSlots - 1)];
+			uint64_t k = s.key.load(std::memory_order_acquire);
+			if (k == 0) {
+				std::copy(frames + 2, frames + 2 + size, s.frames);
+				s.size = size;
+				if (s.key.compare_exchange_strong(k, key, std::memory_order_acq_rel))
+					k = key;
+			}
+			if (k == key) {
+				s.allocations.fetch_add(1, std::memory_order_relaxed);
+				s.bytes.fetch_add(n, std::memory_order_relaxed);
+				break;
+			}
+		}
+		busy = false;
+	}
+
+	inline std::string demangle(const char* symbol) {
+		std::string s(symbol);
+		size_t open = s.find('('), plus = s.find('+', open);
+		if (open == std::string::npos || plus == std::string::npos || plus == open + 1)
+			return s;
+		int status;
+		char* name = abi::__cxa_demangle(s.substr(open + 1, plus - open - 1).c_str(), nullptr, nullptr, &status);
+		if (status != 0)
+			return s;
+		std::string result(name);
+		std::free(name);
+		return result;
+	}
+
+	// Frames of the hooks, allocators and containers say little about who allocated
+	inline bool internal(const std::string &frame) {
+		for (const char* prefix : {"Allocations::", "operator new", "std::", "void std::", "__gnu_cxx::", "ArenaAllocator"})
+			if (frame.compare(0, strlen(prefix), prefix) == 0)
+				return true;
+		return false;
+	}
+
+	// The call stacks that allocated most often, from the first frame outside the library
+	inline void reportSites(std::ostream& out, const size_t top = 10, const int frames = 4) {
+		busy = true;
+		std::vector<Site*> used;
+		for (auto& s : sites)
+			if (s.key.load(std::memory_order_acquire))
+				used.push_back(&s);
+		std::sort(used.begin(), used.end(), [] (Site* a, Site* b) {
+			return a->allocations.load() > b->allocations.load();
+		});
+		for (size_t i = 0; i < used.size() && i < top; i++) {
+			out << used[i]->allocations.load() << " allocations, " << used[i]->bytes.load() << " bytes\n";
+			char** symbols = backtrace_symbols(used[i]->frames, used[i]->size);
+			int shown = 0;
+			for (int f = 0; symbols && f < used[i]->size && shown < frames; f++) {
+				std::string frame = demangle(symbols[f]);
+				if (shown == 0 && internal(frame))
+					continue;
+				out << "    " << frame << '\n';
+				shown++;
+			}
+			std::free(symbols);
+		}
+		busy = false;
+	}
+#else
+	inline void reportSites(std::ostream&, const size_t = 10, const int = 4) {}
+#endif
+
+	inline void counted(const size_t n) {
+		local.allocations++;
+		local.bytes += n;
+		totals.allocations.fetch_add(1, std::memory_order_relaxed);
+		totals.bytes.fetch_add(n, std::memory_order_relaxed);
+#ifdef TRACK_ALLOCATION_SITES
+		recordSite(n);
+#endif
+	}
+
+	inline void released(void* p) {
+		if (!p)
+			return;
+		local.frees++;
+		totals.frees.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	inline void* allocate(const size_t n) {
+		counted(n);
+		void* p = std::malloc(n ? n : 1);
+		if (!p)
+			throw std::bad_alloc();
+		return p;
+	}
+
+	inline void* allocate(const size_t n, const std::align_val_t a) {
+		counted(n);
+		size_t alignment = std::max(sizeof(void*), (size_t) a);
+		void* p;
+		if (posix_memalign(&p, alignment, n ? n : 1) != 0)
+			throw std::bad_alloc();
+		return p;
+	}
+
+	inline void release(void* p) {
+		released(p);
+		std::free(p);
+	}
+}
+
+#ifdef TRACK_ALLOCATIONS
+void* operator new(std::size_t n) {
+	return Allocations::allocate(n);
+}
+
+void* operator new[](std::size_t n) {
+	return Allocations::allocate(n);
+}
+
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept {
+	try {
+		return Allocations::allocate(n);
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+void* operator new[](std::size_t n, const std::nothrow_t&) noexcept {
+	try {
+		return Allocations::allocate(n);
+	} catch (...) {
+		return nullptr;
+	}
+}
+
+void* operator new(std::size_t n, std::align_val_t a) {
+	return Allocations::allocate(n, a);
+}
+
+void* operator new[](std::size_t n, std::align_val_t a) {
+	return Allocations::allocate(n, a);
+}
+
+void operator delete(void* p) noexcept {
+	Allocations::release(p);
+}
+
+void operator delete[](void* p) noexcept {
+	Allocations::release(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	Allocations::release(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+	Allocations::release(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+	Allocations::release(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+	Allocations::release(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+	Allocations::release(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+	Allocations::release(p);
+}
+#endif
+
+#endif
@@ -0,0 +1,227 @@
+#ifndef ALPHABETA
+#define ALPHABETA
+#include "gamestate.cpp"
+#include <vector>
+#include <tuple>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+
+
+// Negamax alpha-beta search with a value evaluator at the leaves.
+// E needs a Scalar type and evaluate(Matrix<Scalar>) scoring a board from the perspective
+// of the player who just moved, like the value ThreadSafePlayer and NTuplePlayer.
+template<typename E>
+class AlphaBeta {
+
+	private:
+
+		enum Bound : uint8_t { EXACT, LOWER, UPPER };
+
+		struct Entry {
+			uint64_t key = 0;
+			double value = 0;
+			int8_t depth = -1;
+			Bound bound = EXACT;
+			int8_t move = -1;
+		};
+
+		constexpr static double infinity = std::numeric_limits<double>::infinity();
+		// Final scores have to dominate any evaluation
+		constexpr static double terminalWeight = 1000;
+		constexpr static int timeCheckInterval = 1024;
+
+		E* evaluator;
+		std::vector<Entry> table;
+		uint64_t mask;
+		uint64_t zobrist[BOARD_SIZE][2];
+
+		std::chrono::steady_clock::time_point start;
+		std::chrono::steady_clock::time_point deadline;
+		long nextCheck = 0;
+		int budget = 0;
+		bool timed = false;
+		bool aborted = false;
+
+		uint64_t hash(const GameState& s) const {
+			uint64_t h = 0;
+			for (int k = 0; k < BOARD_SIZE; k++)
+				if (s.board[k] != 0)
+					h ^= zobrist[k][s.board[k] > 0];
+			return h;
+		}
+
+		double leaf(const GameState& s) {
+			int c = s.getColour();
+			if (s.isFinal())
+				return c * s.getScore() * terminalWeight;
+			return -evaluator->evaluate(-c*s.input<typename E::Scalar>())[0];
+		}
+
+		bool outOfTime() {
+			if (!timed || nodes < nextCheck)
+				return aborted;
+			nextCheck = nodes + timeCheckInterval;
+			if (std::chrono::steady_clock::now() > deadline)
+				aborted = true;
+			return aborted;
+		}
+
+		double negamax(const GameState& s, int depth, double alpha, double beta) {
+
+			nodes++;
+			if (depth == 0 || s.isFinal())
+				return leaf(s);
+			if (outOfTime())
+				return 0;
+
+			double alphaOriginal = alpha;
+			uint64_t key = hash(s);
+			Entry& entry = table[key & mask];
+			int ttMove = -1;
+			if (entry.key == key) {
+				ttMove = entry.move;
+				if (entry.depth >= depth) {
+					if (entry.bound == EXACT)
+						return entry.value;
+					if (entry.bound == LOWER)
+						alpha = std::max(alpha, entry.value);
+					else
+						beta = std::min(beta, entry.value);
+					if (alpha >= beta)
+						return entry.value;
+				}
+			}
+
+			int c = s.getColour();
+			auto moves = s.validMoves(c);
+			std::vector<GameState> children;
+			children.reserve(moves.size());
+			for (auto [i, j] : moves)
+				children.push_back(s.potentialBoard(i, j, c));
+
+			std::vector<int> order = orderMoves(moves, children, depth, ttMove);
+
+			double best = -infinity;
+			int bestMove = -1;
+			for (auto k : order) {
+				double value = -negamax(children[k], depth - 1, -beta, -alpha);
+				if (aborted)
+					return 0;
+				if (value > best) {
+					best = value;
+					auto [i, j] = moves[k];
+					bestMove = GameState::squareIndex(i, j);
+				}
+				alpha = std::max(alpha, value);
+				if (alpha >= beta)
+					break;
+			}
+
+			entry.key = key;
+			entry.value = best;
+			entry.depth = depth;
+			entry.move = bestMove;
+			entry.bound = best <= alphaOriginal ? UPPER : (best >= beta ? LOWER : EXACT);
+			return best;
+		}
+
+		std::vector<int> orderMoves(const std::vector<std::tuple<int, int>>& moves, const std::vector<GameState>& children, int depth, int ttMove) {
+
+			std::vector<int> order(moves.size());
+			std::vector<double> keys(moves.size(), 0);
+			for (unsigned int k = 0; k < moves.size(); k++) {
+				order[k] = k;
+				auto [i, j] = moves[k];
+				if (GameState::squareIndex(i, j) == ttMove)
+					keys[k] = infinity;
+				else if (depth > 1)
+					// Static evaluation of the child for the player to move here
+					keys[k] = -leaf(children[k]);
+			}
+			std::stable_sort(order.begin(), order.end(), [&keys] (int a, int b) {
+				return keys[a] > keys[b];
+			});
+			return order;
+		}
+
+		std::tuple<int, int> root(const GameState& s, int maxDepth) {
+
+			int c = s.getColour();
+			auto moves = s.validMoves(c);
+			std::tuple<int, int> result = moves[0];
+			uint64_t key = hash(s);
+			int remaining = BOARD_SIZE - s.moves;
+			maxDepth = std::min(maxDepth, remaining);
+
+			for (int depth = 1; depth <= maxDepth; depth++) {
+
+				// The first iteration always finishes so there is a move to return
+				timed = budget > 0 && depth > 1;
+				double value = negamax(s, depth, -infinity, infinity);
+				if (aborted)
+					break;
+
+				Entry& entry = table[key & mask];
+				for (auto [i, j] : moves)
+					if (entry.key == key && GameState::squareIndex(i, j) == entry.move)
+						result = {i, j};
+				completedDepth = depth;
+				bestValue = value;
+			}
+
+			seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			return result;
+		}
+
+	public:
+
+		int depth;
+		int timeMs;
+
+		// Statistics of the last search
+		long nodes = 0;
+		double seconds = 0;
+		int completedDepth = 0;
+		double bestValue = 0;
+
+		AlphaBeta(E* e, int d = 64, int t = 0, int tableBits = 20) : evaluator(e), table(size_t(1) << tableBits), mask((uint64_t(1) << tableBits) - 1), depth(d), timeMs(t) {
+			std::mt19937_64 generator(0x5eed);
+			for (int k = 0; k < BOARD_SIZE; k++)
+				for (int c = 0; c < 2; c++)
+					zobrist[k][c] = generator();
+		}
+
+		// Iterative deepening until depth or the time budget runs out, whichever comes first
+		std::tuple<int, int> search(const GameState& s, int budgetMs, int maxDepth = 64) {
+			budget = budgetMs;
+			nodes = 0;
+			nextCheck = 0;
+			aborted = false;
+			start = std::chrono::steady_clock::now();
+			deadline = start + std::chrono::milliseconds(budgetMs);
+			return root(s, maxDepth);
+		}
+
+		// Fixed depth without time control, reproducible for training
+		std::tuple<int, int> searchDepth(const GameState& s, int d) {
+			return search(s, 0, d);
+		}
+
+		std::tuple<int, int> predictMove(const GameState& s) {
+			return timeMs > 0 ? search(s, timeMs, depth) : searchDepth(s, depth);
+		}
+
+		double nodesPerSecond() const {
+			return seconds > 0 ? nodes / seconds : 0;
+		}
+
+		void clear() {
+			std::fill(table.begin(), table.end(), Entry());
+		}
+
+};
+
+#endif
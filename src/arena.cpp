@@ -0,0 +1,178 @@
+#ifndef ARENA
+#define ARENA
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <sys/mman.h>
+
+
+// Bump allocator over a chunk of one reserved address range. While an Arena is
+// active on a thread, every Matrix that thread allocates is placed in it, so
+// the memory is first touched, and therefore placed, on the NUMA node of that
+// thread. Freeing arena memory is a no-op, reset() releases everything at once.
+class Arena {
+
+	private:
+
+		// Address space only, chunks become usable when an Arena takes them
+		constexpr static size_t reservation = size_t(1) << 38;
+		constexpr static size_t hugePage = size_t(2) << 20;
+
+		// Null until the first Arena is constructed, so plain heap users never reserve anything
+		static std::atomic<char*>& published() {
+			static std::atomic<char*> base(nullptr);
+			return base;
+		}
+
+		// Only called by the constructor
+		static char* region() {
+			static char* base = [] {
+				void* p = mmap(nullptr, reservation, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+				char* b = p == MAP_FAILED ? nullptr : (char*) p;
+				published().store(b, std::memory_order_release);
+				return b;
+			}();
+			return base;
+		}
+
+		static std::atomic<size_t>& reserved() {
+			static std::atomic<size_t> used(0);
+			return used;
+		}
+
+		static Arena*& active() {
+			static thread_local Arena* current = nullptr;
+			return current;
+		}
+
+		char* base = nullptr;
+		size_t capacity = 0;
+		size_t used = 0;
+
+	public:
+
+		// Allocations that did not fit and went to the heap instead
+		size_t overflows = 0;
+
+		// With hugepages the chunk is backed by transparent huge pages where the kernel allows it
+		Arena(size_t bytes, bool hugepages = false) {
+			bytes = (bytes + hugePage - 1) / hugePage * hugePage;
+			size_t offset = reserved().fetch_add(bytes);
+			if (!region() || offset + bytes > reservation)
+				return;
+			char* chunk = region() + offset;
+			if (mprotect(chunk, bytes, PROT_READ | PROT_WRITE) != 0)
+				return;
+#ifdef MADV_HUGEPAGE
+			if (hugepages)
+				madvise(chunk, bytes, MADV_HUGEPAGE);
+#endif
+			base = chunk;
+			capacity = bytes;
+		}
+
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+
+		// Gives the pages back, the address range itself stays reserved
+		~Arena() {
+			if (base) {
+				madvise(base, capacity, MADV_DONTNEED);
+				mprotect(base, capacity, PROT_NONE);
+			}
+		}
+
+		// Null when full, the caller falls back to the heap
+		void* allocate(const size_t bytes, const size_t alignment = alignof(std::max_align_t)) {
+			size_t start = (used + alignment - 1) / alignment * alignment;
+			if (start + bytes > capacity) {
+				overflows++;
+				return nullptr;
+			}
+			used = start + bytes;
+			return base + start;
+		}
+
+		// Everything allocated in the arena has to be unused by now
+		void reset() {
+			used = 0;
+			overflows = 0;
+		}
+
+		inline size_t size() const {
+			return used;
+		}
+
+		// Whether p lies in this arena
+		inline bool contains(const void* p) const {
+			const char* c = (const char*) p;
+			return c >= base && c < base + capacity;
+		}
+
+		// Whether p lies in any arena, such memory is not freed on its own
+		static inline bool owns(const void* p) {
+			const char* c = (const char*) p;
+			const char* r = published().load(std::memory_order_acquire);
+			return r && c >= r && c < r + reservation;
+		}
+
+		static inline Arena* current() {
+			return active();
+		}
+
+		// Makes an arena the target of this thread's Matrix allocations for its lifetime
+		class Scope {
+
+			private:
+
+				Arena* previous;
+
+			public:
+
+				Scope(Arena* a) : previous(active()) {
+					active() = a;
+				}
+
+				~Scope() {
+					active() = previous;
+				}
+		};
+};
+
+
+// Stateless allocator for Matrix storage: the active arena of the thread if any, the heap otherwise
+template<typename T>
+struct ArenaAllocator {
+
+	using value_type = T;
+
+	ArenaAllocator() = default;
+
+	template<typename U>
+	ArenaAllocator(const ArenaAllocator<U>&) {}
+
+	T* allocate(const size_t n) {
+		if (Arena* a = Arena::current())
+			if (void* p = a->allocate(n * sizeof(T), alignof(T) < 64 ? 64 : alignof(T)))
+				return (T*) p;
+		return (T*) ::operator new(n * sizeof(T));
+	}
+
+	void deallocate(T* p, const size_t) {
+		if (!Arena::owns(p))
+			::operator delete(p);
+	}
+
+	template<typename U>
+	bool operator==(const ArenaAllocator<U>&) const {
+		return true;
+	}
+
+	template<typename U>
+	bool operator!=(const ArenaAllocator<U>&) const {
+		return false;
+	}
+};
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef BENCHMARK
+#define BENCHMARK
+#include <vector>
+#include <string>
+#include <map>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+
+
+// Keeps the compiler from removing a computation whose result is not used
+template<typename V>
+inline void keep(V const& value) {
+	asm volatile("" : : "g"(&value) : "memory");
+}
+
+
+struct BenchmarkResult {
+	std::string name;
+	// Median and fastest of the samples, in nanoseconds per call
+	double ns = 0;
+	double minNs = 0;
+	long calls = 0;
+	// Work per call, such as games or bytes, and its unit
+	double items = 1;
+	std::string unit = "calls";
+
+	inline double itemsPerSecond() const {
+		return ns > 0 ? items * 1e9 / ns : 0;
+	}
+
+	std::string json() const {
+		std::ostringstream s;
+		s << std::setprecision(6) << "{\"name\":\"" << name << "\",\"ns\":" << ns << ",\"min_ns\":" << minNs << ",\"calls\":" << calls
+			<< ",\"items\":" << items << ",\"unit\":\"" << unit << "\",\"per_sec\":" << itemsPerSecond() << "}";
+		return s.str();
+	}
+
+	// Only reads what json() writes
+	static bool parse(const std::string &line, BenchmarkResult &r) {
+		auto field = [&line](const std::string &key) -> std::string {
+			size_t p = line.find("\"" + key + "\":");
+			if (p == std::string::npos)
+				return "";
+			p += key.size() + 3;
+			if (line[p] == '"')
+				return line.substr(p + 1, line.find('"', p + 1) - p - 1);
+			return line.substr(p, line.find_first_of(",}", p) - p);
+		};
+		r.name = field("name");
+		std::string ns = field("ns");
+		if (r.name.empty() || ns.empty())
+			return false;
+		r.ns = std::stod(ns);
+		std::string minNs = field("min_ns");
+		r.minNs = minNs.empty() ? r.ns : std::stod(minNs);
+		return true;
+	}
+};
+
+
+// Runs named benchmarks: every one is calibrated to take at least minSeconds per
+// sample and sampled a few times, the median is reported. Results can be written
+// as JSON lines and compared to a baseline written by an earlier run.
+class BenchmarkSuite {
+
+	private:
+
+		std::vector<BenchmarkResult> results;
+
+	public:
+
+		double minSeconds = 0.1;
+		int samples = 5;
+		// Only benchmarks whose name contains this are run
+		std::string filter;
+
+		bool selected(const std::string &name) const {
+			return name.find(filter) != std::string::npos;
+		}
+
+		// f does one call worth items units of work
+		void run(const std::string &name, const std::function<void()> &f, const double items = 1, const std::string &unit = "calls") {
+			if (!selected(name))
+				return;
+			using clock = std::chrono::steady_clock;
+			f();
+			long calls = 1;
+			while (true) {
+				auto start = clock::now();
+				for (long i = 0; i < calls; i++)
+					f();
+				double seconds = std::chrono::duration<double>(clock::now() - start).count();
+				if (seconds >= minSeconds || calls >= (1L << 30))
+					break;
+				calls = seconds > 0 ? std::max(calls * 2, (long) (calls * minSeconds * 1.2 / seconds)) : calls * 10;
+			}
+			std::vector<double> times;
+			for (int s = 0; s < samples; s++) {
+				auto start = clock::now();
+				for (long i = 0; i < calls; i++)
+					f();
+				times.push_back(std::chrono::duration<double, std::nano>(clock::now() - start).count() / calls);
+			}
+			std::sort(times.begin(), times.end());
+			BenchmarkResult r;
+			r.name = name;
+			r.ns = times[times.size() / 2];
+			r.minNs = times[0];
+			r.calls = calls;
+			r.items = items;
+			r.unit = unit;
+			results.push_back(r);
+			std::cout << std::left << std::setw(44) << name << std::right << std::setw(14) << std::fixed << std::setprecision(1) << r.ns << " ns"
+				<< std::setw(16) << std::setprecision(1) << r.itemsPerSecond() << " " << unit << "/s" << std::defaultfloat << std::endl;
+		}
+
+		// Expensive benchmarks that time themselves, seconds is the duration of one call
+		void record(const std::string &name, const double seconds, const double items = 1, const std::string &unit = "calls") {
+			BenchmarkResult r;
+			r.name = name;
+			r.ns = r.minNs = seconds * 1e9;
+			r.calls = 1;
+			r.items = items;
+			r.unit = unit;
+			results.push_back(r);
+			std::cout << std::left << std::setw(44) << name << std::right << std::setw(14) << std::fixed << std::setprecision(1) << r.ns << " ns"
+				<< std::setw(16) << std::setprecision(1) << r.itemsPerSecond() << " " << unit << "/s" << std::defaultfloat << std::endl;
+		}
+
+		const std::vector<BenchmarkResult>& all() const {
+			return results;
+		}
+
+		void write(const std::string &filename) const {
+			std::ofstream file(filename);
+			if (!file) {
+				std::cerr << "Could not create " << filename << std::endl;
+				throw "Could not write benchmark results";
+			}
+			for (auto& r : results)
+				file << r.json() << '\n';
+		}
+
+		// Prints the change of every benchmark that is in both, returns how many got slower than tolerance allows.
+		// The fastest samples are compared, they vary least between runs on a busy machine.
+		int compare(const std::string &baseline, const double tolerance = 0.1) const {
+			std::ifstream file(baseline);
+			if (!file) {
+				std::cout << "No baseline " << baseline << ", save one with make bench-baseline" << std::endl;
+				return 0;
+			}
+			std::map<std::string, double> before;
+			std::string line;
+			BenchmarkResult r;
+			while (std::getline(file, line))
+				if (BenchmarkResult::parse(line, r))
+					before[r.name] = r.minNs;
+			int regressions = 0;
+			std::cout << "Compared to " << baseline << ":" << std::endl;
+			for (auto& now : results) {
+				auto b = before.find(now.name);
+				if (b == before.end() || b->second <= 0)
+					continue;
+				double change = now.minNs / b->second - 1;
+				bool slower = change > tolerance;
+				regressions += slower;
+				std::cout << std::left << std::setw(44) << now.name << std::right << std::showpos << std::fixed << std::setprecision(1)
+					<< std::setw(9) << 100 * change << "%" << std::noshowpos << std::defaultfloat << (slower ? "  REGRESSION" : change < -tolerance ? "  faster" : "") << std::endl;
+			}
+			return regressions;
+		}
+};
+
+#endif
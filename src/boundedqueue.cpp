@@ -0,0 +1,91 @@
+#ifndef BOUNDEDQUEUE
+#define BOUNDEDQUEUE
+#include <atomic>
+#include <memory>
+#include <cstddef>
+
+
+// Lock-free multi-producer multi-consumer queue of fixed capacity (rounded up to a power of two).
+// Every cell carries a sequence number telling producers and consumers whose turn it is.
+template<typename T>
+class BoundedQueue {
+
+	private:
+
+		struct Cell {
+			std::atomic<size_t> sequence;
+			T value;
+		};
+
+		std::unique_ptr<Cell[]> cells;
+		size_t mask;
+		alignas(64) std::atomic<size_t> enqueuePosition;
+		alignas(64) std::atomic<size_t> dequeuePosition;
+
+	public:
+
+		BoundedQueue(size_t capacity) : enqueuePosition(0), dequeuePosition(0) {
+			size_t n = 2;
+			while (n < capacity)
+				n *= 2;
+			cells.reset(new Cell[n]);
+			mask = n - 1;
+			for (size_t i = 0; i < n; i++)
+				cells[i].sequence.store(i, std::memory_order_relaxed);
+		}
+
+		// False when the queue is full
+		bool push(const T& value) {
+			size_t position = enqueuePosition.load(std::memory_order_relaxed);
+			while (true) {
+				Cell& cell = cells[position & mask];
+				size_t sequence = cell.sequence.load(std::memory_order_acquire);
+				intptr_t difference = (intptr_t) sequence - (intptr_t) position;
+				if (difference == 0) {
+					if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+						cell.value = value;
+						cell.sequence.store(position + 1, std::memory_order_release);
+						return true;
+					}
+				} else if (difference < 0) {
+					return false;
+				} else {
+					position = enqueuePosition.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// False when the queue is empty
+		bool pop(T& value) {
+			size_t position = dequeuePosition.load(std::memory_order_relaxed);
+			while (true) {
+				Cell& cell = cells[position & mask];
+				size_t sequence = cell.sequence.load(std::memory_order_acquire);
+				intptr_t difference = (intptr_t) sequence - (intptr_t) (position + 1);
+				if (difference == 0) {
+					if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+						value = std::move(cell.value);
+						cell.sequence.store(position + mask + 1, std::memory_order_release);
+						return true;
+					}
+				} else if (difference < 0) {
+					return false;
+				} else {
+					position = dequeuePosition.load(std::memory_order_relaxed);
+				}
+			}
+		}
+
+		// Approximate while producers or consumers are active
+		size_t size() const {
+			size_t in = enqueuePosition.load(std::memory_order_relaxed);
+			size_t out = dequeuePosition.load(std::memory_order_relaxed);
+			return in > out ? in - out : 0;
+		}
+
+		inline size_t capacity() const {
+			return mask + 1;
+		}
+};
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef CHECKPOINT
+#define CHECKPOINT
+#include "matrix.cpp"
+#include "randomgenerator.cpp"
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+// Snapshot of a whole population, file layout (.ssvc):
+// magic SSVC, version, generation, players, length and text of the RNG state,
+// then for every player its score and each weight and bias matrix as
+// rows, columns, scalar size and the row-major data
+class Checkpoint {
+
+	private:
+
+		constexpr static char magic[4] = {'S', 'S', 'V', 'C'};
+		constexpr static uint32_t version = 1;
+
+		std::vector<char> bytes;
+		size_t cursor = 0;
+
+		void put(const void* data, const size_t n) {
+			const char* p = (const char*) data;
+			bytes.insert(bytes.end(), p, p + n);
+		}
+
+		template<typename V>
+		void put(const V value) {
+			put(&value, sizeof(V));
+		}
+
+		void get(void* data, const size_t n) {
+			if (cursor + n > bytes.size())
+				throw "Truncated checkpoint";
+			memcpy(data, bytes.data() + cursor, n);
+			cursor += n;
+		}
+
+		template<typename V>
+		V get() {
+			V value;
+			get(&value, sizeof(V));
+			return value;
+		}
+
+		template<typename S>
+		void putMatrices(const std::vector<Matrix<S>>& matrices) {
+			put<uint32_t>(matrices.size());
+			for (auto& m : matrices) {
+				put<uint64_t>(m.rows);
+				put<uint64_t>(m.columns);
+				put<uint32_t>(sizeof(S));
+				put(m.raw(), m.size() * sizeof(S));
+			}
+		}
+
+		template<typename S, typename F>
+		void getConverted(Matrix<S>& m) {
+			std::vector<F> temp(m.size());
+			get(temp.data(), temp.size() * sizeof(F));
+			std::copy(temp.begin(), temp.end(), m.raw());
+		}
+
+		// The population has to be built with the same shapes, float and double checkpoints are converted
+		template<typename S>
+		void getMatrices(std::vector<Matrix<S>>& matrices) {
+			if (get<uint32_t>() != matrices.size())
+				throw "Checkpoint does not match the population";
+			for (auto& m : matrices) {
+				uint64_t rows = get<uint64_t>(), columns = get<uint64_t>();
+				if (rows != m.rows || columns != m.columns)
+					throw "Checkpoint does not match the population";
+				uint32_t scalarSize = get<uint32_t>();
+				if (scalarSize == sizeof(S))
+					get(m.raw(), m.size() * sizeof(S));
+				else if (scalarSize == sizeof(float))
+					getConverted<S, float>(m);
+				else if (scalarSize == sizeof(double))
+					getConverted<S, double>(m);
+				else
+					throw "Checkpoint does not match the population";
+			}
+		}
+
+	public:
+
+		// Called between generations, only copies memory so it is cheap enough to do often
+		template<typename P>
+		static Checkpoint snapshot(const std::vector<P*>& players, const int generation) {
+			Checkpoint c;
+			std::ostringstream rng;
+			rng << RandomGenerator::generator;
+			std::string state = rng.str();
+
+			c.put(magic, sizeof(magic));
+			c.put<uint32_t>(version);
+			c.put<int64_t>(generation);
+			c.put<uint64_t>(players.size());
+			c.put<uint32_t>(state.size());
+			c.put(state.data(), state.size());
+			for (auto p : players) {
+				c.put<double>(p->getScore());
+				c.putMatrices(p->weights);
+				c.putMatrices(p->biases);
+			}
+			return c;
+		}
+
+		// Overwrites genomes, scores and the RNG state of this thread, returns the generation
+		template<typename P>
+		int restore(std::vector<P*>& players) {
+			cursor = 0;
+			char m[4];
+			get(m, sizeof(m));
+			if (memcmp(m, magic, sizeof(m)) != 0 || get<uint32_t>() != version)
+				throw "Not a checkpoint";
+			int generation = get<int64_t>();
+			if (get<uint64_t>() != players.size())
+				throw "Checkpoint does not match the population";
+			std::string state(get<uint32_t>(), ' ');
+			get(&state[0], state.size());
+			for (auto p : players) {
+				p->setScore(get<double>());
+				getMatrices(p->weights);
+				getMatrices(p->biases);
+			}
+			std::istringstream rng(state);
+			rng >> RandomGenerator::generator;
+			return generation;
+		}
+
+		inline size_t size() const {
+			return bytes.size();
+		}
+
+		// Written next to the target and renamed over it, a crash leaves the previous checkpoint intact
+		void write(const std::string &filename) const {
+			std::string temp = filename + ".tmp";
+			int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			if (fd < 0) {
+				std::cerr << "Could not create " << temp << std::endl;
+				throw "Could not write checkpoint";
+			}
+			size_t done = 0;
+			while (done < bytes.size()) {
+				ssize_t n = ::write(fd, bytes.data() + done, bytes.size() - done);
+				if (n <= 0) {
+					close(fd);
+					throw "Could not write checkpoint";
+				}
+				done += n;
+			}
+			fsync(fd);
+			close(fd);
+			if (rename(temp.c_str(), filename.c_str()) != 0)
+				throw "Could not replace checkpoint";
+		}
+
+		static Checkpoint read(const std::string &filename) {
+			std::ifstream file(filename, std::ios::binary);
+			if (!file) {
+				std::cerr << "Could not open " << filename << std::endl;
+				throw "Could not read checkpoint";
+			}
+			Checkpoint c;
+			c.bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+			return c;
+		}
+};
+
+
+// Writes checkpoints on its own thread. When a new one arrives while the
+// previous is still being written, only the newest waiting one is kept.
+class CheckpointWriter {
+
+	private:
+
+		std::thread writer;
+		std::mutex mutex;
+		std::condition_variable available;
+		std::unique_ptr<Checkpoint> pending;
+		std::string pendingFile;
+		bool busy = false;
+		bool stopping = false;
+
+		void work() {
+			while (true) {
+				std::unique_ptr<Checkpoint> c;
+				std::string filename;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					available.wait(lock, [this] { return stopping || pending; });
+					if (!pending)
+						return;
+					c = std::move(pending);
+					filename = pendingFile;
+					busy = true;
+				}
+				try {
+					c->write(filename);
+					written++;
+				} catch (const char* e) {
+					std::cerr << e << std::endl;
+					failed++;
+				}
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					busy = false;
+				}
+				available.notify_all();
+			}
+		}
+
+	public:
+
+		std::atomic<int> written;
+		std::atomic<int> failed;
+		std::atomic<int> skipped;
+
+		CheckpointWriter() : written(0), failed(0), skipped(0) {
+			writer = std::thread(&CheckpointWriter::work, this);
+		}
+
+		void submit(Checkpoint&& c, const std::string &filename) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				if (pending)
+					skipped++;
+				pending.reset(new Checkpoint(std::move(c)));
+				pendingFile = filename;
+			}
+			available.notify_all();
+		}
+
+		// Block until everything submitted is on disk
+		void flush() {
+			std::unique_lock<std::mutex> lock(mutex);
+			available.wait(lock, [this] { return !pending && !busy; });
+		}
+
+		~CheckpointWriter() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			available.notify_all();
+			writer.join();
+		}
+};
+
+#endif
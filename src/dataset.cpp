@@ -0,0 +1,262 @@
+#ifndef DATASET
+#define DATASET
+#include "matrix.cpp"
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <random>
+#include <numeric>
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+// Read-only mapping of a binary matrix file (.ssvb), rows are used in place
+template<typename T>
+class MappedMatrix {
+
+	private:
+
+		void* mapping = nullptr;
+		size_t bytes = 0;
+
+	public:
+
+		size_t rows = 0;
+		size_t columns = 0;
+
+		MappedMatrix(const std::string &filename) {
+			int fd = open(filename.c_str(), O_RDONLY);
+			struct stat st;
+			if (fd < 0 || fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(MatrixHeader)) {
+				if (fd >= 0)
+					close(fd);
+				std::cerr << "Error reading " << filename << std::endl;
+				throw "Error reading file";
+			}
+			bytes = st.st_size;
+			mapping = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+			close(fd);
+			if (mapping == MAP_FAILED)
+				throw "Could not map file";
+
+			const MatrixHeader* header = (const MatrixHeader*) mapping;
+			if (!header->valid() || header->scalarSize != sizeof(T) || bytes < sizeof(MatrixHeader) + header->rows * header->columns * sizeof(T)) {
+				munmap(mapping, bytes);
+				std::cerr << filename << " is not a binary matrix of " << sizeof(T) << " byte scalars" << std::endl;
+				throw "Invalid binary matrix";
+			}
+			rows = header->rows;
+			columns = header->columns;
+			// Minibatches jump around the file, readahead would mostly load unused pages
+			madvise(mapping, bytes, MADV_RANDOM);
+		}
+
+		MappedMatrix(const MappedMatrix&) = delete;
+		MappedMatrix& operator=(const MappedMatrix&) = delete;
+
+		inline const T* row(const size_t r) const {
+			return (const T*) ((const char*) mapping + sizeof(MatrixHeader)) + r * columns;
+		}
+
+		~MappedMatrix() {
+			munmap(mapping, bytes);
+		}
+};
+
+
+// Inputs and targets of a supervised dataset from two mapped .ssvb files.
+// Epochs are shuffled minibatches; a prefetch thread gathers the next batch into
+// one of two aligned, locked buffers while the current one is being trained on.
+template<typename T>
+class Dataset {
+
+	public:
+
+		// Rows of one minibatch, valid until the next call to next()
+		struct Batch {
+			const T* inputs;
+			const T* targets;
+			size_t size;
+		};
+
+	private:
+
+		struct Buffer {
+			T* inputs = nullptr;
+			T* targets = nullptr;
+			size_t size = 0;
+		};
+
+		constexpr static size_t alignment = 64;
+
+		MappedMatrix<T> input;
+		MappedMatrix<T> target;
+		size_t batchSize;
+		bool prefetch;
+
+		std::vector<size_t> order;
+		std::default_random_engine generator;
+		size_t position = 0;
+
+		Buffer buffers[2];
+		std::thread worker;
+		std::mutex mutex;
+		std::condition_variable changed;
+		// Batches handed to and taken by the consumer, the buffer of batch k is k % 2
+		size_t produced = 0;
+		size_t consumed = 0;
+		bool holding = false;
+		bool stopping = false;
+
+		static inline size_t bytes(const size_t n) {
+			return (n * sizeof(T) + alignment - 1) / alignment * alignment;
+		}
+
+		static T* allocate(const size_t n) {
+			T* p = (T*) std::aligned_alloc(alignment, bytes(n));
+			if (!p)
+				throw "Could not allocate batch buffer";
+			// Best effort, keeps the buffers from being swapped out
+			mlock(p, bytes(n));
+			return p;
+		}
+
+		static void release(T* p, const size_t n) {
+			munlock(p, bytes(n));
+			std::free(p);
+		}
+
+		// The next batch of the epoch into b, size 0 marks the end of the epoch
+		void gather(Buffer& b) {
+			if (position == order.size()) {
+				std::shuffle(order.begin(), order.end(), generator);
+				position = 0;
+				b.size = 0;
+				return;
+			}
+			b.size = std::min(batchSize, order.size() - position);
+			for (size_t s = 0; s < b.size; s++) {
+				size_t r = order[position + s];
+				std::copy(input.row(r), input.row(r) + input.columns, b.inputs + s * input.columns);
+				std::copy(target.row(r), target.row(r) + target.columns, b.targets + s * target.columns);
+			}
+			position += b.size;
+		}
+
+		void work() {
+			while (true) {
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					changed.wait(lock, [this] { return stopping || produced - consumed < 2; });
+					if (stopping)
+						return;
+				}
+				gather(buffers[produced % 2]);
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					produced++;
+				}
+				changed.notify_all();
+			}
+		}
+
+	public:
+
+		Dataset(const std::string &inputFile, const std::string &targetFile, size_t b, bool p = true) : input(inputFile), target(targetFile), batchSize(b), prefetch(p), order(input.rows), generator(time(0)) {
+			if (input.rows != target.rows) {
+				std::cerr << "Inputs have " << input.rows << " rows, targets " << target.rows << std::endl;
+				throw "Inputs and targets differ in length";
+			}
+			if (input.rows == 0 || input.columns == 0 || target.columns == 0) {
+				std::cerr << inputFile << " and " << targetFile << " hold no data" << std::endl;
+				throw "Empty dataset";
+			}
+			if (batchSize == 0)
+				throw "Batch size has to be positive";
+			std::iota(order.begin(), order.end(), 0);
+			std::shuffle(order.begin(), order.end(), generator);
+			for (auto& buffer : buffers) {
+				buffer.inputs = allocate(batchSize * input.columns);
+				buffer.targets = allocate(batchSize * target.columns);
+			}
+			if (prefetch)
+				worker = std::thread(&Dataset::work, this);
+		}
+
+		Dataset(const Dataset&) = delete;
+		Dataset& operator=(const Dataset&) = delete;
+
+		inline size_t size() const {
+			return input.rows;
+		}
+
+		inline size_t inputColumns() const {
+			return input.columns;
+		}
+
+		inline size_t targetColumns() const {
+			return target.columns;
+		}
+
+		// Rows straight from the mapping, without copying
+		inline const T* inputRow(const size_t r) const {
+			return input.row(r);
+		}
+
+		inline const T* targetRow(const size_t r) const {
+			return target.row(r);
+		}
+
+		// Consecutive rows [first, first + n) in file order, also without copying.
+		// Cut off at the end of the data, empty when first == size()
+		Batch rows(const size_t first, const size_t n) const {
+			if (first > size()) {
+				std::cerr << "Row " << first << " of " << size() << std::endl;
+				throw "Rows out of range";
+			}
+			return {input.row(first), target.row(first), std::min(n, size() - first)};
+		}
+
+		// False at the end of an epoch, the following call starts the next one
+		bool next(Batch& batch) {
+			Buffer* b;
+			if (prefetch) {
+				std::unique_lock<std::mutex> lock(mutex);
+				if (holding)
+					consumed++;
+				changed.notify_all();
+				changed.wait(lock, [this] { return produced > consumed; });
+				holding = true;
+				b = &buffers[consumed % 2];
+			} else {
+				b = &buffers[0];
+				gather(*b);
+			}
+			batch = {b->inputs, b->targets, b->size};
+			return b->size > 0;
+		}
+
+		~Dataset() {
+			if (worker.joinable()) {
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					stopping = true;
+				}
+				changed.notify_all();
+				worker.join();
+			}
+			for (auto& buffer : buffers) {
+				release(buffer.inputs, batchSize * input.columns);
+				release(buffer.targets, batchSize * target.columns);
+			}
+		}
+};
+
+#endif
@@ -0,0 +1,337 @@
+#ifndef ENDGAME
+#define ENDGAME
+#include "gamestate.cpp"
+#include "threadpool.cpp"
+#include <vector>
+#include <tuple>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <limits>
+
+
+// Position as two bitboards from the perspective of the player to move,
+// bit k is square k of GameState::board (k = i + j * BOARD_WIDTH)
+struct Bitboard {
+
+	uint64_t own;
+	uint64_t opp;
+
+	constexpr static uint64_t notFirst = 0xfefefefefefefefeULL;
+	constexpr static uint64_t notLast = 0x7f7f7f7f7f7f7f7fULL;
+
+	Bitboard() : own(0), opp(0) {}
+
+	Bitboard(uint64_t o, uint64_t p) : own(o), opp(p) {}
+
+	Bitboard(const GameState& s) : Bitboard(s, s.getColour()) {}
+
+	// From the perspective of colour c
+	Bitboard(const GameState& s, const int c) : own(0), opp(0) {
+		for (int k = 0; k < BOARD_SIZE; k++) {
+			if (s.board[k] == c)
+				own |= uint64_t(1) << k;
+			else if (s.board[k] != 0)
+				opp |= uint64_t(1) << k;
+		}
+	}
+
+	inline uint64_t occupied() const {
+		return own | opp;
+	}
+
+	inline int empties() const {
+		return __builtin_popcountll(~occupied());
+	}
+
+	// Final score for the player to move
+	inline int score() const {
+		return __builtin_popcountll(own) - __builtin_popcountll(opp);
+	}
+
+	// Board as network input from the perspective of own, one row of a batch matrix
+	void decode(double* row) const {
+		for (int k = 0; k < BOARD_SIZE; k++)
+			row[k] = (own >> k & 1) ? 1 : ((opp >> k & 1) ? -1 : 0);
+	}
+
+	static inline uint64_t neighbours(uint64_t b) {
+		b |= (b << 8) | (b >> 8);
+		return b | ((b << 1) & notFirst) | ((b >> 1) & notLast);
+	}
+
+	// Squares between the move and the farthest own piece of each contiguous line
+	uint64_t flips(const int square) const;
+
+	// Flipping moves if there are any, otherwise every empty square next to a piece
+	uint64_t moves() const {
+		uint64_t empty = ~occupied();
+		uint64_t candidates = neighbours(occupied()) & empty;
+		uint64_t flipping = 0;
+		for (uint64_t m = candidates; m; m &= m - 1) {
+			int square = __builtin_ctzll(m);
+			if (flips(square))
+				flipping |= uint64_t(1) << square;
+		}
+		return flipping ? flipping : candidates;
+	}
+
+	// Play a move and swap perspective to the opponent
+	Bitboard play(const int square) const {
+		uint64_t f = flips(square);
+		return Bitboard(opp ^ f, own ^ f ^ (uint64_t(1) << square));
+	}
+};
+
+struct Rays {
+
+	// For every square and direction the squares along it, terminated by -1
+	int8_t squares[BOARD_SIZE][8][8];
+
+	Rays() {
+		int d = 0;
+		for (int di = -1; di < 2; di++) {
+			for (int dj = -1; dj < 2; dj++) {
+				if (di == 0 && dj == 0)
+					continue;
+				for (int k = 0; k < BOARD_SIZE; k++) {
+					int i = k % BOARD_WIDTH + di, j = k / BOARD_WIDTH + dj, n = 0;
+					while (0 <= i && i < BOARD_HEIGHT && 0 <= j && j < BOARD_WIDTH) {
+						squares[k][d][n++] = GameState::squareIndex(i, j);
+						i += di; j += dj;
+					}
+					for (; n < 8; n++)
+						squares[k][d][n] = -1;
+				}
+				d++;
+			}
+		}
+	}
+};
+
+const Rays rays;
+
+inline uint64_t Bitboard::flips(const int square) const {
+	uint64_t occ = occupied();
+	uint64_t result = 0;
+	for (int d = 0; d < 8; d++) {
+		const int8_t *ray = rays.squares[square][d];
+		uint64_t line = 0, flipped = 0;
+		for (int n = 0; n < 8 && ray[n] >= 0; n++) {
+			uint64_t bit = uint64_t(1) << ray[n];
+			if (!(occ & bit))
+				break;
+			if (own & bit)
+				flipped = line;
+			line |= bit;
+		}
+		result |= flipped;
+	}
+	return result;
+}
+
+
+// Perfect play for the last few empty squares, score is the final disc difference
+class EndgameSolver {
+
+	private:
+
+		enum Bound : uint8_t { EXACT, LOWER, UPPER };
+
+		struct Entry {
+			uint64_t own = 0;
+			uint64_t opp = 0;
+			int8_t value = 0;
+			Bound bound = EXACT;
+			int8_t move = -1;
+		};
+
+		constexpr static int infinity = BOARD_SIZE + 1;
+		// Below this many empties parity ordering is cheaper than counting replies
+		constexpr static int fastestFirstEmpties = 7;
+		constexpr static int ttEmpties = 5;
+
+		std::vector<Entry> table;
+		uint64_t mask;
+
+		// Quadrant masks, moves in a quadrant with an odd number of empties come first
+		constexpr static uint64_t quadrants[4] = {
+			0x000000000f0f0f0fULL, 0x00000000f0f0f0f0ULL,
+			0x0f0f0f0f00000000ULL, 0xf0f0f0f000000000ULL
+		};
+
+		static inline uint64_t hash(const Bitboard& b) {
+			uint64_t h = b.own * 0x9e3779b97f4a7c15ULL ^ (b.opp + 0x632be59bd9b4e019ULL) * 0xbf58476d1ce4e5b9ULL;
+			return h ^ (h >> 31);
+		}
+
+		uint64_t oddRegions(const Bitboard& b) const {
+			uint64_t empty = ~b.occupied(), result = 0;
+			for (auto q : quadrants)
+				if (__builtin_popcountll(empty & q) & 1)
+					result |= q;
+			return result;
+		}
+
+		int order(const Bitboard& b, uint64_t moves, int8_t ttMove, int *list) {
+			int n = 0;
+			int keys[BOARD_SIZE];
+			uint64_t odd = oddRegions(b);
+			bool fastest = b.empties() >= fastestFirstEmpties;
+			for (uint64_t m = moves; m; m &= m - 1) {
+				int square = __builtin_ctzll(m);
+				int key = (odd >> square) & 1;
+				if (fastest)
+					key -= 2 * __builtin_popcountll(b.play(square).moves());
+				if (square == ttMove)
+					key = infinity * 4;
+				// Insertion sort, lists are at most a handful of moves long
+				int k = n++;
+				while (k > 0 && keys[k - 1] < key) {
+					keys[k] = keys[k - 1];
+					list[k] = list[k - 1];
+					k--;
+				}
+				keys[k] = key;
+				list[k] = square;
+			}
+			return n;
+		}
+
+		int negamax(const Bitboard& b, int alpha, int beta) {
+
+			nodes++;
+			uint64_t moves = b.moves();
+			if (!moves)
+				return b.score();
+
+			int empties = b.empties();
+			if (empties == 1)
+				return -b.play(__builtin_ctzll(moves)).score();
+
+			Entry* entry = nullptr;
+			int8_t ttMove = -1;
+			int alphaOriginal = alpha;
+			if (empties >= ttEmpties) {
+				entry = &table[hash(b) & mask];
+				if (entry->own == b.own && entry->opp == b.opp) {
+					ttMove = entry->move;
+					if (entry->bound == EXACT)
+						return entry->value;
+					if (entry->bound == LOWER)
+						alpha = std::max(alpha, (int) entry->value);
+					else
+						beta = std::min(beta, (int) entry->value);
+					if (alpha >= beta)
+						return entry->value;
+				}
+			}
+
+			int list[BOARD_SIZE];
+			int n = order(b, moves, ttMove, list);
+			int best = -infinity;
+			int bestMove = -1;
+			for (int k = 0; k < n; k++) {
+				int value = -negamax(b.play(list[k]), -beta, -alpha);
+				if (value > best) {
+					best = value;
+					bestMove = list[k];
+				}
+				alpha = std::max(alpha, value);
+				if (alpha >= beta)
+					break;
+			}
+
+			if (entry) {
+				entry->own = b.own;
+				entry->opp = b.opp;
+				entry->value = best;
+				entry->move = bestMove;
+				entry->bound = best <= alphaOriginal ? UPPER : (best >= beta ? LOWER : EXACT);
+			}
+			return best;
+		}
+
+	public:
+
+		long nodes = 0;
+
+		EndgameSolver(int tableBits = 18) : table(size_t(1) << tableBits), mask((uint64_t(1) << tableBits) - 1) {}
+
+		// Exact final disc difference for the player to move
+		int solve(const Bitboard& b, int alpha = -infinity, int beta = infinity) {
+			return negamax(b, alpha, beta);
+		}
+
+		int solve(const GameState& s) {
+			return solve(Bitboard(s));
+		}
+
+		// A final position has no move, both return (-1, -1) and its score
+		std::tuple<int, int> bestMove(const GameState& s, int *score = nullptr) {
+			Bitboard b(s);
+			if (!b.moves()) {
+				if (score)
+					*score = b.score();
+				return {-1, -1};
+			}
+			int list[BOARD_SIZE] = {};
+			int n = order(b, b.moves(), -1, list);
+			int best = -infinity, bestSquare = list[0];
+			for (int k = 0; k < n; k++) {
+				int value = -negamax(b.play(list[k]), -infinity, -best);
+				if (value > best) {
+					best = value;
+					bestSquare = list[k];
+				}
+			}
+			if (score)
+				*score = best;
+			return {bestSquare % BOARD_WIDTH, bestSquare / BOARD_WIDTH};
+		}
+
+		// Root moves are solved in parallel, each task with its own table,
+		// the best score so far narrows the window of the remaining ones
+		static std::tuple<int, int> bestMoveParallel(const GameState& s, ThreadPool& pool, int *score = nullptr, long *totalNodes = nullptr) {
+			Bitboard b(s);
+			uint64_t moves = b.moves();
+			if (!moves) {
+				if (score)
+					*score = b.score();
+				return {-1, -1};
+			}
+			std::vector<int> list;
+			for (uint64_t m = moves; m; m &= m - 1)
+				list.push_back(__builtin_ctzll(m));
+
+			std::atomic<int> best(-infinity);
+			std::atomic<long> nodeCount(0);
+			int bestSquare = list[0];
+			std::mutex bestMutex;
+
+			pool.parallelFor(list.size(), [&] (size_t k) {
+				thread_local EndgameSolver solver;
+				long before = solver.nodes;
+				int alpha = best.load();
+				int value = -solver.solve(b.play(list[k]), -infinity, -alpha);
+				nodeCount += solver.nodes - before;
+				std::lock_guard<std::mutex> lock(bestMutex);
+				if (value > best.load()) {
+					best = value;
+					bestSquare = list[k];
+				}
+			});
+
+			if (score)
+				*score = best;
+			if (totalNodes)
+				*totalNodes = nodeCount;
+			return {bestSquare % BOARD_WIDTH, bestSquare / BOARD_WIDTH};
+		}
+
+		void clear() {
+			std::fill(table.begin(), table.end(), Entry());
+		}
+};
+
+#endif
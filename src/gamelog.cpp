@@ -0,0 +1,340 @@
+#ifndef GAMELOG
+#define GAMELOG
+#include "gamestate.cpp"
+#include "boundedqueue.cpp"
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+
+
+// One finished game. A Flippo game always fills the board, so it has exactly
+// BOARD_SIZE - 4 moves, stored as square indices (i + j * BOARD_WIDTH)
+struct GameRecord {
+
+	constexpr static int numMoves = BOARD_SIZE - 4;
+	// Moves take 6 bits each on disk
+	constexpr static size_t packedMoves = numMoves * 6 / 8;
+	constexpr static size_t packedSize = 4 + 4 + 1 + packedMoves;
+
+	uint32_t white = 0;
+	uint32_t black = 0;
+	// Final score, positive when white wins
+	int8_t score = 0;
+	uint8_t moves[numMoves];
+
+	void pack(uint8_t* out) const {
+		memcpy(out, &white, 4);
+		memcpy(out + 4, &black, 4);
+		out[8] = score;
+		uint8_t* packed = out + 9;
+		// Four moves per three bytes
+		for (int k = 0; k < numMoves; k += 4) {
+			uint32_t bits = moves[k] | moves[k + 1] << 6 | moves[k + 2] << 12 | moves[k + 3] << 18;
+			*packed++ = bits;
+			*packed++ = bits >> 8;
+			*packed++ = bits >> 16;
+		}
+	}
+
+	void unpack(const uint8_t* in) {
+		memcpy(&white, in, 4);
+		memcpy(&black, in + 4, 4);
+		score = in[8];
+		const uint8_t* packed = in + 9;
+		for (int k = 0; k < numMoves; k += 4) {
+			uint32_t bits = packed[0] | packed[1] << 8 | packed[2] << 16;
+			packed += 3;
+			for (int m = 0; m < 4; m++)
+				moves[k + m] = bits >> (6 * m) & 63;
+		}
+	}
+
+	// Calls visit(state, colour) after every move, colour is the player who just moved
+	template<typename F>
+	void replay(F visit) const {
+		GameState s;
+		for (int k = 0; k < numMoves; k++) {
+			int c = s.getColour();
+			s.placePiece(moves[k] % BOARD_WIDTH, moves[k] / BOARD_WIDTH, c);
+			visit(s, c);
+		}
+	}
+};
+
+namespace GameLogFormat {
+	constexpr char magic[8] = {'F', 'L', 'P', 'G', 'A', 'M', 'E', 'S'};
+	constexpr uint32_t version = 1;
+
+	// File: 16 byte header, blocks of {generation, count, records}, the block index, footer
+	struct IndexEntry {
+		uint64_t offset;
+		uint64_t firstGame;
+		uint32_t generation;
+		uint32_t count;
+	};
+
+	struct Footer {
+		uint64_t indexOffset;
+		uint64_t blocks;
+		char magic[8];
+	};
+}
+
+
+// Game records from the competition workers. Every worker fills its own block,
+// so recording takes no locks, and full blocks go to a background writer.
+class GameLog {
+
+	private:
+
+		struct Block {
+			uint32_t generation = 0;
+			uint32_t count = 0;
+			std::vector<uint8_t> data;
+		};
+
+		FILE* file;
+		std::vector<Block*> current;
+		BoundedQueue<Block*> full;
+		BoundedQueue<Block*> spare;
+		std::vector<GameLogFormat::IndexEntry> index;
+		std::thread writer;
+		std::atomic<bool> stopping;
+		uint32_t generation = 0;
+		uint64_t offset = 0;
+		uint64_t games = 0;
+
+		Block* newBlock() {
+			Block* block;
+			if (!spare.pop(block)) {
+				block = new Block();
+				block->data.resize(blockGames * GameRecord::packedSize);
+			}
+			block->generation = generation;
+			block->count = 0;
+			return block;
+		}
+
+		void submit(Block* block) {
+			while (!full.push(block)) {
+				stalls.fetch_add(1, std::memory_order_relaxed);
+				std::this_thread::yield();
+			}
+		}
+
+		void write(Block* block) {
+			uint32_t header[2] = {block->generation, block->count};
+			size_t bytes = block->count * GameRecord::packedSize;
+			fwrite(header, sizeof(header), 1, file);
+			fwrite(block->data.data(), 1, bytes, file);
+			index.push_back({offset, games, block->generation, block->count});
+			offset += sizeof(header) + bytes;
+			games += block->count;
+			written.fetch_add(block->count, std::memory_order_relaxed);
+			if (!spare.push(block))
+				delete block;
+		}
+
+		void work() {
+			while (true) {
+				bool stop = stopping.load(std::memory_order_acquire);
+				Block* block;
+				if (full.pop(block))
+					write(block);
+				else if (stop)
+					break;
+				else
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+
+	public:
+
+		constexpr static uint32_t blockGames = 1 << 12;
+
+		std::atomic<uint64_t> written;
+		std::atomic<uint64_t> stalls;
+
+		// One buffer per worker thread, record() takes the worker's slot
+		GameLog(const std::string& filename, size_t slots) : full(1 << 8), spare(1 << 8), stopping(false), written(0), stalls(0) {
+			file = fopen(filename.c_str(), "wb");
+			if (!file) {
+				std::cerr << "Could not create " << filename << std::endl;
+				throw "Could not create game log";
+			}
+			uint32_t header[2] = {GameLogFormat::version, (uint32_t) GameRecord::packedSize};
+			fwrite(GameLogFormat::magic, 1, sizeof(GameLogFormat::magic), file);
+			fwrite(header, sizeof(header), 1, file);
+			offset = sizeof(GameLogFormat::magic) + sizeof(header);
+			for (size_t i = 0; i < slots; i++)
+				current.push_back(newBlock());
+			writer = std::thread(&GameLog::work, this);
+		}
+
+		inline size_t slots() const {
+			return current.size();
+		}
+
+		// Between generations, for when the number of workers grows
+		void growSlots(const size_t n) {
+			while (current.size() < n)
+				current.push_back(newBlock());
+		}
+
+		void record(const size_t slot, const GameRecord& game) {
+			Block* block = current[slot];
+			game.pack(block->data.data() + block->count * GameRecord::packedSize);
+			if (++block->count == blockGames) {
+				submit(block);
+				current[slot] = newBlock();
+			}
+		}
+
+		// Between generations, when no worker is recording: hand over the partial
+		// blocks so every block belongs to a single generation
+		void nextGeneration(const uint32_t g) {
+			generation = g;
+			for (auto& block : current) {
+				if (block->count) {
+					submit(block);
+					block = newBlock();
+				}
+				block->generation = g;
+			}
+		}
+
+		// Write the remaining games and the index
+		void close() {
+			if (!file)
+				return;
+			// Only flush, no fresh blocks for a generation that will not come
+			for (auto block : current) {
+				if (block->count)
+					submit(block);
+				else
+					delete block;
+			}
+			current.clear();
+			stopping.store(true, std::memory_order_release);
+			writer.join();
+
+			GameLogFormat::Footer footer = {offset, index.size(), {}};
+			memcpy(footer.magic, GameLogFormat::magic, sizeof(footer.magic));
+			fwrite(index.data(), sizeof(GameLogFormat::IndexEntry), index.size(), file);
+			fwrite(&footer, sizeof(footer), 1, file);
+			fclose(file);
+			file = nullptr;
+
+			Block* block;
+			while (spare.pop(block))
+				delete block;
+		}
+
+		~GameLog() {
+			close();
+		}
+};
+
+
+class GameLogReader {
+
+	private:
+
+		FILE* file;
+		std::vector<GameLogFormat::IndexEntry> index;
+		std::vector<uint8_t> buffer;
+		// Block currently in buffer
+		long loaded = -1;
+
+		void load(const size_t block) {
+			if ((long) block == loaded)
+				return;
+			const auto& entry = index[block];
+			buffer.resize(entry.count * GameRecord::packedSize);
+			fseek(file, entry.offset + 2 * sizeof(uint32_t), SEEK_SET);
+			if (fread(buffer.data(), 1, buffer.size(), file) != buffer.size())
+				throw "Truncated game log";
+			loaded = block;
+		}
+
+	public:
+
+		GameLogReader(const std::string& filename) {
+			file = fopen(filename.c_str(), "rb");
+			if (!file) {
+				std::cerr << "Could not open " << filename << std::endl;
+				throw "Could not open game log";
+			}
+			char magic[8];
+			uint32_t header[2];
+			GameLogFormat::Footer footer;
+			if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) || fread(header, sizeof(header), 1, file) != 1
+					|| memcmp(magic, GameLogFormat::magic, sizeof(magic)) != 0 || header[1] != GameRecord::packedSize) {
+				fclose(file);
+				throw "Invalid game log";
+			}
+			// A log without footer was not closed
+			fseek(file, -(long) sizeof(footer), SEEK_END);
+			if (fread(&footer, sizeof(footer), 1, file) != 1 || memcmp(footer.magic, GameLogFormat::magic, sizeof(magic)) != 0) {
+				fclose(file);
+				throw "Game log has no index";
+			}
+			index.resize(footer.blocks);
+			fseek(file, footer.indexOffset, SEEK_SET);
+			if (fread(index.data(), sizeof(GameLogFormat::IndexEntry), index.size(), file) != index.size()) {
+				fclose(file);
+				throw "Truncated game log";
+			}
+		}
+
+		GameLogReader(const GameLogReader&) = delete;
+		GameLogReader& operator=(const GameLogReader&) = delete;
+
+		inline size_t size() const {
+			return index.empty() ? 0 : index.back().firstGame + index.back().count;
+		}
+
+		inline const std::vector<GameLogFormat::IndexEntry>& blocks() const {
+			return index;
+		}
+
+		// Random access through the block index
+		GameRecord operator[](const size_t game) {
+			size_t lo = 0, hi = index.size();
+			while (hi - lo > 1) {
+				size_t mid = (lo + hi) / 2;
+				if (index[mid].firstGame <= game)
+					lo = mid;
+				else
+					hi = mid;
+			}
+			load(lo);
+			GameRecord r;
+			r.unpack(buffer.data() + (game - index[lo].firstGame) * GameRecord::packedSize);
+			return r;
+		}
+
+		// Every game in file order, f(record, generation)
+		template<typename F>
+		void forEach(F f) {
+			GameRecord r;
+			for (size_t b = 0; b < index.size(); b++) {
+				load(b);
+				for (uint32_t k = 0; k < index[b].count; k++) {
+					r.unpack(buffer.data() + k * GameRecord::packedSize);
+					f(r, index[b].generation);
+				}
+			}
+		}
+
+		~GameLogReader() {
+			fclose(file);
+		}
+};
+
+#endif
@@ -4,8 +4,10 @@
 #include <string>
 #include <sstream>
 #include <tuple>
+#include <type_traits>
 #include "matrix.cpp"
 #include "neural-network.cpp"
+#include "instrument.cpp"
 #include <iostream>
 
 const int MAX_SCORE = 64;
@@ -33,6 +35,7 @@ public:
 	GameState(Matrix<double> b, int m = 4) : board(b), moves(m) {}
 
 	void placePiece(const int i, const int j, const double c) {
+		INSTRUMENT_SCOPE(placePiece);
 		board(i, j) = c;
 		// Loop over directions
 		for (int di = -1; di < 2; di++) {
@@ -137,6 +140,7 @@ public:
 	}
 
 	std::vector<std::tuple<int, int>> validMoves(const double c) const {
+		INSTRUMENT_SCOPE(validMoves);
 
 		Matrix<int> move_matrix(BOARD_HEIGHT, BOARD_WIDTH);
 			std::vector<std::tuple<int, int>> indices;
@@ -166,8 +170,17 @@ public:
 
 	}
 
-	Matrix<double> input() {
-		return board.reshape(BOARD_SIZE, 1);
+	// The board as one column, in the scalar type of the network it is fed to
+	template<typename T = double>
+	Matrix<T> input() const {
+		if constexpr (std::is_same_v<T, double>)
+			return board.reshape(BOARD_SIZE, 1);
+		else {
+			// Converted while copying, one allocation
+			Matrix<T> m(BOARD_SIZE, 1);
+			std::copy(board.raw(), board.raw() + BOARD_SIZE, m.raw());
+			return m;
+		}
 	}
 
 	inline bool isFinal() const {
@@ -179,7 +192,7 @@ public:
 		return board.toString();
 	}
 
-	int emptyPlaces() {
+	int emptyPlaces() const {
 		int result = 0;
 		for (int i = 0; i < BOARD_HEIGHT; i++)
 			for (int j = 0; j < BOARD_WIDTH; j++)
@@ -190,6 +203,11 @@ public:
 	int getColour() const {
 		return (moves % 2) ? -1 : 1;
 	}
+
+	static inline int squareIndex(const int i, const int j) {
+		// Index of (i, j) in board, input() and a policy output
+		return i + j * BOARD_WIDTH;
+	}
 };
 
 std::ostream& operator<<(std::ostream& os, const GameState& m) {
@@ -0,0 +1,264 @@
+#ifndef INSTRUMENTATION
+#define INSTRUMENTATION
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+
+// Hot-path counters and latency histograms, only compiled in with -DINSTRUMENT
+// (make instrument). Without it the INSTRUMENT_ macros expand to nothing.
+// Every thread records into its own data, aggregation reads it with relaxed loads.
+namespace Instrument {
+
+	enum Probe { evaluate, validMoves, placePiece, predictMove, game, probes };
+	enum Counter { games, steals, endgameMoves, counters };
+
+	constexpr const char* probeNames[probes] = {"evaluate", "validMoves", "placePiece", "predictMove", "game"};
+	constexpr const char* counterNames[counters] = {"games", "steals", "endgameMoves"};
+
+	// Log-linear buckets as in HDR histograms: 32 per power of two, under 3% relative error
+	constexpr int subBits = 5;
+	constexpr int subBuckets = 1 << subBits;
+	constexpr int buckets = 41 * subBuckets;
+
+	inline int bucket(const uint64_t ns) {
+		if (ns < (uint64_t) subBuckets)
+			return ns;
+		int e = 63 - __builtin_clzll(ns);
+		return std::min((e - subBits + 1) * subBuckets + (int) ((ns >> (e - subBits)) & (subBuckets - 1)), buckets - 1);
+	}
+
+	// Middle of the range of nanoseconds that falls into bucket b
+	inline double bucketValue(const int b) {
+		if (b < subBuckets)
+			return b;
+		int m = b / subBuckets;
+		uint64_t width = uint64_t(1) << (m - 1);
+		return (subBuckets + b % subBuckets) * width + width / 2.0;
+	}
+
+	// C is std::atomic<uint64_t> for the live per-thread data and uint64_t for aggregates
+	template<typename C>
+	struct Histogram {
+		C counts[buckets] = {};
+		C total = {};
+		C sum = {};
+		C max = {};
+	};
+
+	struct ThreadData {
+		std::atomic<uint64_t> counts[counters] = {};
+		Histogram<std::atomic<uint64_t>> histograms[probes];
+	};
+
+	// Only the owning thread writes, so a load and a store are enough
+	inline void bump(std::atomic<uint64_t>& c, const uint64_t n = 1) {
+		c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+	}
+
+	inline uint64_t load(const std::atomic<uint64_t>& c) {
+		return c.load(std::memory_order_relaxed);
+	}
+
+	inline uint64_t load(const uint64_t c) {
+		return c;
+	}
+
+	// Sum of any number of threads, or the difference of two sums
+	struct Snapshot {
+		uint64_t counts[counters] = {};
+		Histogram<uint64_t> histograms[probes];
+
+		void add(const ThreadData& d) {
+			for (int c = 0; c < counters; c++)
+				counts[c] += load(d.counts[c]);
+			for (int p = 0; p < probes; p++) {
+				auto& h = histograms[p];
+				auto& t = d.histograms[p];
+				for (int b = 0; b < buckets; b++)
+					h.counts[b] += load(t.counts[b]);
+				h.total += load(t.total);
+				h.sum += load(t.sum);
+				h.max = std::max(h.max, load(t.max));
+			}
+		}
+
+		// What happened since the earlier snapshot, the maximum is that of the whole run
+		Snapshot since(const Snapshot& earlier) const {
+			Snapshot d = *this;
+			for (int c = 0; c < counters; c++)
+				d.counts[c] -= earlier.counts[c];
+			for (int p = 0; p < probes; p++) {
+				for (int b = 0; b < buckets; b++)
+					d.histograms[p].counts[b] -= earlier.histograms[p].counts[b];
+				d.histograms[p].total -= earlier.histograms[p].total;
+				d.histograms[p].sum -= earlier.histograms[p].sum;
+			}
+			return d;
+		}
+
+		// Latency in nanoseconds below which a fraction q of the samples lies, at most the maximum
+		double percentile(const Probe p, const double q) const {
+			const auto& h = histograms[p];
+			if (!h.total)
+				return 0;
+			uint64_t rank = std::max<uint64_t>(1, q * h.total + 0.5), seen = 0;
+			for (int b = 0; b < buckets; b++) {
+				seen += h.counts[b];
+				if (seen >= rank)
+					return std::min(bucketValue(b), (double) h.max);
+			}
+			return h.max;
+		}
+
+		// One line per probe with samples, latencies in microseconds
+		void print(std::ostream& out) const {
+			out << std::fixed << std::setprecision(2);
+			for (int p = 0; p < probes; p++) {
+				const auto& h = histograms[p];
+				if (!h.total)
+					continue;
+				out << std::setw(12) << probeNames[p] << ": " << h.total << " calls, mean " << h.sum / 1e3 / h.total
+					<< " p50 " << percentile((Probe) p, 0.5) / 1e3 << " p99 " << percentile((Probe) p, 0.99) / 1e3
+					<< " p999 " << percentile((Probe) p, 0.999) / 1e3 << " max " << h.max / 1e3 << " us\n";
+			}
+			for (int c = 0; c < counters; c++)
+				out << std::setw(12) << counterNames[c] << ": " << counts[c] << '\n';
+			out << std::defaultfloat;
+		}
+	};
+
+	// Data of running threads, and the sum of threads that have exited
+	struct Registry {
+		std::mutex mutex;
+		std::vector<ThreadData*> live;
+		Snapshot retired;
+	};
+
+	inline Registry& registry() {
+		static Registry* r = new Registry();
+		return *r;
+	}
+
+	// Registers the data of a thread and folds it into the retired sum when the thread exits
+	struct Local {
+		ThreadData* data;
+
+		Local() : data(new ThreadData()) {
+			std::lock_guard<std::mutex> lock(registry().mutex);
+			registry().live.push_back(data);
+		}
+
+		~Local() {
+			Registry& r = registry();
+			std::lock_guard<std::mutex> lock(r.mutex);
+			r.retired.add(*data);
+			r.live.erase(std::find(r.live.begin(), r.live.end(), data));
+			delete data;
+		}
+	};
+
+	inline ThreadData& local() {
+		static thread_local Local l;
+		return *l.data;
+	}
+
+	inline void count(const Counter c, const uint64_t n = 1) {
+		bump(local().counts[c], n);
+	}
+
+	inline void record(const Probe p, const uint64_t ns) {
+		auto& h = local().histograms[p];
+		bump(h.counts[bucket(ns)]);
+		bump(h.total);
+		bump(h.sum, ns);
+		if (ns > load(h.max))
+			h.max.store(ns, std::memory_order_relaxed);
+	}
+
+	// Everything recorded so far by all threads
+	inline Snapshot snapshot() {
+		Registry& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		Snapshot s = r.retired;
+		for (auto d : r.live)
+			s.add(*d);
+		return s;
+	}
+
+	// Times its own lifetime
+	class Timer {
+
+		private:
+
+			Probe probe;
+			std::chrono::steady_clock::time_point start;
+
+		public:
+
+			Timer(const Probe p) : probe(p), start(std::chrono::steady_clock::now()) {}
+
+			~Timer() {
+				record(probe, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+			}
+	};
+
+	// Prints what happened in every interval on its own thread
+	class Reporter {
+
+		private:
+
+			std::thread thread;
+			std::mutex mutex;
+			std::condition_variable wake;
+			bool stopping = false;
+
+		public:
+
+			Reporter(const double seconds, std::ostream& out = std::cout) {
+				thread = std::thread([this, seconds, &out] {
+					Snapshot previous = snapshot();
+					std::unique_lock<std::mutex> lock(mutex);
+					while (!wake.wait_for(lock, std::chrono::duration<double>(seconds), [this] { return stopping; })) {
+						Snapshot current = snapshot();
+						out << "Instrumentation, last " << seconds << " s:\n";
+						current.since(previous).print(out);
+						out.flush();
+						previous = current;
+					}
+				});
+			}
+
+			Reporter(const Reporter&) = delete;
+			Reporter& operator=(const Reporter&) = delete;
+
+			~Reporter() {
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					stopping = true;
+				}
+				wake.notify_all();
+				thread.join();
+			}
+	};
+}
+
+#define INSTRUMENT_CONCAT2(a, b) a##b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT2(a, b)
+
+#ifdef INSTRUMENT
+#define INSTRUMENT_SCOPE(probe) Instrument::Timer INSTRUMENT_CONCAT(instrumentTimer, __LINE__)(Instrument::probe)
+#define INSTRUMENT_COUNT(counter) Instrument::count(Instrument::counter)
+#else
+#define INSTRUMENT_SCOPE(probe)
+#define INSTRUMENT_COUNT(counter)
+#endif
+
+#endif
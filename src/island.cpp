@@ -0,0 +1,329 @@
+#ifndef ISLAND
+#define ISLAND
+#include "supervisor.cpp"
+#include "affinity.cpp"
+#include <vector>
+#include <atomic>
+#include <functional>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <new>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+
+// Genome as one flat vector: every weight matrix, then every bias
+namespace Genome {
+
+	template<typename P>
+	size_t size(P* p) {
+		size_t n = 0;
+		for (auto& m : p->weights)
+			n += m.size();
+		for (auto& m : p->biases)
+			n += m.size();
+		return n;
+	}
+
+	template<typename P>
+	void get(P* p, double* out) {
+		for (auto& m : p->weights)
+			out = std::copy(m.raw(), m.raw() + m.size(), out);
+		for (auto& m : p->biases)
+			out = std::copy(m.raw(), m.raw() + m.size(), out);
+	}
+
+	template<typename P>
+	void set(P* p, const double* in) {
+		for (auto& m : p->weights) {
+			std::copy(in, in + m.size(), m.raw());
+			in += m.size();
+		}
+		for (auto& m : p->biases) {
+			std::copy(in, in + m.size(), m.raw());
+			in += m.size();
+		}
+	}
+}
+
+
+// Ring of genomes that one island publishes and its neighbour reads, placed in
+// memory shared between the island processes. There is a single writer; every
+// slot has a sequence number that is odd while it is written, like WeightSnapshot.
+class MigrationRing {
+
+	private:
+
+		char* base;
+		size_t genomeSize;
+		size_t slots;
+		size_t stride;
+
+		inline std::atomic<uint64_t>& published() const {
+			return *(std::atomic<uint64_t>*) base;
+		}
+
+		inline std::atomic<uint64_t>& sequence(const size_t k) const {
+			return *(std::atomic<uint64_t>*) (base + 64 + k * stride);
+		}
+
+		// Score first, then the genome
+		inline std::atomic<double>* values(const size_t k) const {
+			return (std::atomic<double>*) (base + 64 + k * stride + sizeof(std::atomic<uint64_t>));
+		}
+
+	public:
+
+		static size_t slotBytes(const size_t genomeSize) {
+			return (sizeof(std::atomic<uint64_t>) + (genomeSize + 1) * sizeof(std::atomic<double>) + 63) / 64 * 64;
+		}
+
+		static size_t bytes(const size_t genomeSize, const size_t slots) {
+			return 64 + slots * slotBytes(genomeSize);
+		}
+
+		MigrationRing(void* memory, const size_t g, const size_t s, const bool initialize) : base((char*) memory), genomeSize(g), slots(s), stride(slotBytes(g)) {
+			if (!initialize)
+				return;
+			new (&published()) std::atomic<uint64_t>(0);
+			for (size_t k = 0; k < slots; k++) {
+				new (&sequence(k)) std::atomic<uint64_t>(0);
+				for (size_t i = 0; i <= genomeSize; i++)
+					new (&values(k)[i]) std::atomic<double>(0);
+			}
+		}
+
+		inline uint64_t count() const {
+			return published().load(std::memory_order_acquire);
+		}
+
+		inline size_t capacity() const {
+			return slots;
+		}
+
+		void publish(const double* genome, const double score) {
+			uint64_t n = published().load(std::memory_order_relaxed);
+			size_t k = n % slots;
+			sequence(k).store(2 * n + 1, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			std::atomic<double>* v = values(k);
+			v[0].store(score, std::memory_order_relaxed);
+			for (size_t i = 0; i < genomeSize; i++)
+				v[i + 1].store(genome[i], std::memory_order_relaxed);
+			sequence(k).store(2 * n + 2, std::memory_order_release);
+			published().store(n + 1, std::memory_order_release);
+		}
+
+		// Genome number n, false if it has been overwritten in the meantime
+		bool read(const uint64_t n, double* genome, double& score) const {
+			size_t k = n % slots;
+			if (sequence(k).load(std::memory_order_acquire) != 2 * n + 2)
+				return false;
+			std::atomic<double>* v = values(k);
+			score = v[0].load(std::memory_order_relaxed);
+			for (size_t i = 0; i < genomeSize; i++)
+				genome[i] = v[i + 1].load(std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_acquire);
+			return sequence(k).load(std::memory_order_relaxed) == 2 * n + 2;
+		}
+};
+
+
+// What every island reports to the coordinator, in shared memory
+struct IslandStats {
+	std::atomic<long> generation;
+	std::atomic<long> games;
+	std::atomic<long> immigrants;
+	std::atomic<double> best;
+	std::atomic<double> mean;
+	std::atomic<double> seconds;
+
+	IslandStats() : generation(0), games(0), immigrants(0), best(0), mean(0), seconds(0) {}
+};
+
+
+// Island model: every island is a separate process with its own Supervisor,
+// optionally pinned to a NUMA node, so its population is allocated and used there.
+// Every migrationRate generations an island publishes its best genomes and
+// replaces its worst players with the newest genomes of the previous island.
+// The calling process is the coordinator, it merges the statistics of all islands.
+template<typename P = ThreadSafePlayer<>>
+class IslandModel {
+
+	private:
+
+		std::function<Supervisor<P>*()> factory;
+		size_t genomeSize = 0;
+		void* shared = nullptr;
+		size_t sharedBytes = 0;
+		std::vector<IslandStats*> stats;
+		std::vector<MigrationRing> rings;
+
+		void island(const int index, const int generations) {
+			if (pin)
+				Affinity::pinToNode(index);
+			// The forked generator is the coordinator's, every island needs its own sequence
+			RandomGenerator::generator.seed(time(0) ^ getpid() ^ (index * 0x9e3779b9u));
+			// Built after pinning so the population is first touched on this node
+			Supervisor<P>* super = factory();
+			IslandStats& s = *stats[index];
+			MigrationRing& outbox = rings[index];
+			MigrationRing& inbox = rings[(index + islands - 1) % islands];
+			std::vector<double> genome(genomeSize);
+			uint64_t seen = 0;
+			long n = super->players.size();
+			auto start = std::chrono::steady_clock::now();
+
+			for (int g = 1; g <= generations; g++) {
+				super->evolve(1, mutationChance, crossoverChance, false, false);
+
+				if (g % migrationRate == 0) {
+					super->sortPlayersByScore();
+					for (int k = 0; k < migrants && k < n; k++) {
+						Genome::get(super->players[k], genome.data());
+						outbox.publish(genome.data(), super->players[k]->getScore());
+					}
+					// Only the newest genomes, older ones may already be overwritten
+					uint64_t available = inbox.count();
+					uint64_t first = std::max(seen, available > (uint64_t) migrants ? available - migrants : 0);
+					int replaced = 0;
+					for (uint64_t m = first; m < available && replaced < n; m++) {
+						double score;
+						if (!inbox.read(m, genome.data(), score))
+							continue;
+						P* worst = super->players[n - 1 - replaced++];
+						Genome::set(worst, genome.data());
+						worst->setScore(score);
+					}
+					seen = available;
+					s.immigrants.fetch_add(replaced, std::memory_order_relaxed);
+				}
+
+				double best = 0, total = 0;
+				for (auto p : super->players) {
+					best = std::max(best, p->getScore());
+					total += p->getScore();
+				}
+				s.best.store(best, std::memory_order_relaxed);
+				s.mean.store(total / n, std::memory_order_relaxed);
+				s.games.fetch_add(n * (n - 1), std::memory_order_relaxed);
+				s.seconds.store(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), std::memory_order_relaxed);
+				s.generation.store(g, std::memory_order_release);
+			}
+			delete super;
+		}
+
+		void report() const {
+			long minGeneration = stats.empty() ? 0 : stats[0]->generation.load();
+			double best = 0, mean = 0;
+			long immigrants = 0;
+			for (auto s : stats) {
+				minGeneration = std::min(minGeneration, s->generation.load());
+				best = std::max(best, s->best.load());
+				mean += s->mean.load() / islands;
+				immigrants += s->immigrants.load();
+			}
+			std::cout << "Islands: " << islands << " Generation: " << minGeneration << " Games: " << games << " Games/sec: " << gamesPerSecond()
+				<< " Best: " << best << " Mean: " << mean << " Immigrants: " << immigrants << std::endl;
+		}
+
+	public:
+
+		int islands;
+		int migrationRate;
+		int migrants;
+		bool pin = true;
+		double mutationChance = 0.001;
+		double crossoverChance = 0.1;
+
+		// Merged statistics of the last run
+		long games = 0;
+		double seconds = 0;
+		// Islands of the last run that crashed or exited with an error
+		int failed = 0;
+
+		// factory builds the Supervisor of an island, it is called inside the island process.
+		// sample has the shape of the players it builds, it gives the genome size
+		IslandModel(int n, std::function<Supervisor<P>*()> f, const P& sample, int rate = 5, int m = 2) : factory(f), genomeSize(Genome::size(&sample)), islands(n), migrationRate(rate), migrants(m) {}
+
+		IslandModel(const IslandModel&) = delete;
+		IslandModel& operator=(const IslandModel&) = delete;
+
+		double gamesPerSecond() const {
+			return seconds > 0 ? games / seconds : 0;
+		}
+
+		void run(int generations, bool verbose = true, double reportSeconds = 1) {
+			size_t statsBytes = (sizeof(IslandStats) + 63) / 64 * 64;
+			size_t ringBytes = MigrationRing::bytes(genomeSize, 4 * std::max(migrants, 1));
+			sharedBytes = islands * (statsBytes + ringBytes);
+			shared = mmap(nullptr, sharedBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+			if (shared == MAP_FAILED)
+				throw "Could not map shared memory";
+
+			char* cursor = (char*) shared;
+			stats.clear();
+			rings.clear();
+			for (int i = 0; i < islands; i++) {
+				stats.push_back(new (cursor) IslandStats());
+				cursor += statsBytes;
+			}
+			for (int i = 0; i < islands; i++) {
+				rings.emplace_back(cursor, genomeSize, 4 * std::max(migrants, 1), true);
+				cursor += ringBytes;
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			std::vector<pid_t> children;
+			for (int i = 0; i < islands; i++) {
+				pid_t pid = fork();
+				if (pid < 0)
+					throw "Could not start island";
+				if (pid == 0) {
+					// The child must not return into the coordinator's code, even on an error
+					try {
+						island(i, generations);
+					} catch (...) {
+						_exit(1);
+					}
+					_exit(0);
+				}
+				children.push_back(pid);
+			}
+
+			size_t running = children.size();
+			failed = 0;
+			while (running) {
+				std::this_thread::sleep_for(std::chrono::duration<double>(reportSeconds));
+				for (size_t i = 0; i < children.size(); i++) {
+					int status;
+					if (children[i] > 0 && waitpid(children[i], &status, WNOHANG) == children[i]) {
+						children[i] = -1;
+						running--;
+						if (WIFSIGNALED(status)) {
+							std::cerr << "Island " << i << " was killed by signal " << WTERMSIG(status) << std::endl;
+							failed++;
+						} else if (WEXITSTATUS(status) != 0) {
+							std::cerr << "Island " << i << " exited with status " << WEXITSTATUS(status) << std::endl;
+							failed++;
+						}
+					}
+				}
+				games = 0;
+				for (auto s : stats)
+					games += s->games.load(std::memory_order_relaxed);
+				seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				if (verbose)
+					report();
+			}
+
+			munmap(shared, sharedBytes);
+			shared = nullptr;
+			stats.clear();
+			rings.clear();
+		}
+};
+
+#endif
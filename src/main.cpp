@@ -7,7 +7,14 @@
 using namespace std;
 
 
-Supervisor *super;
+// make float32 builds the whole population in single precision
+#ifdef FLOAT32
+using Scalar = float;
+#else
+using Scalar = double;
+#endif
+
+Supervisor<ThreadSafePlayer<Scalar>> *super;
 
 // Save best player
 void gracefulExit(int signum) {
@@ -17,13 +24,24 @@ void gracefulExit(int signum) {
   super->sortPlayersByScore();
   super->players[0]->saveNetwork(filename);
   cout << "Best player saved" << endl;
+#ifdef TRACK_ALLOCATION_SITES
+  cout << "Most frequent allocation sites:" << endl;
+  Allocations::reportSites(cout);
+#endif
   exit(signum);
 }
 
 int main() {
   	signal(SIGINT, gracefulExit);
-    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
-    super = new Supervisor(640, {64, 32, 1}, s, l);
+    Function<Scalar> *s = new Sigmoid<Scalar>(), *l = new Linear<Scalar>();
+    super = new Supervisor<ThreadSafePlayer<Scalar>>(640, {64, 32, 1}, s, l);
+    if (super->resume("population.ssvc"))
+      cout << "Resumed from generation " << super->generation << endl;
+    super->checkpointEvery(10, "population.ssvc");
+    super->logMetrics("metrics.jsonl");
+#ifdef INSTRUMENT
+    Instrument::Reporter reporter(60);
+#endif
     super->evolve(-1);
     delete s; delete l; delete super;
 }
@@ -8,7 +8,35 @@
 #include <functional>
 #include <fstream>
 #include <ctime>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include "randomgenerator.cpp"
+#include "arena.cpp"
+
+// Binary matrix file (.ssvb): this 64 byte header and the row-major data
+// right after it, so the data is aligned when the file is mapped
+struct MatrixHeader {
+	constexpr static char binaryMagic[4] = {'S', 'S', 'V', 'B'};
+	constexpr static uint32_t binaryVersion = 1;
+
+	char magic[4];
+	uint32_t version;
+	// 4 for float, 8 for double
+	uint32_t scalarSize;
+	uint32_t reserved;
+	uint64_t rows;
+	uint64_t columns;
+	char padding[32];
+
+	MatrixHeader(const uint64_t r = 0, const uint64_t c = 0, const uint32_t s = 8) : version(binaryVersion), scalarSize(s), reserved(0), rows(r), columns(c), padding() {
+		memcpy(magic, binaryMagic, sizeof(magic));
+	}
+
+	bool valid() const {
+		return memcmp(magic, binaryMagic, sizeof(magic)) == 0 && version == binaryVersion && (scalarSize == 4 || scalarSize == 8);
+	}
+};
 
 template <typename T>
 class Matrix {
@@ -16,7 +44,8 @@ class Matrix {
 
 		// Member variables
 
-		std::vector<T> data;
+		// Served from the active Arena of the thread, if any
+		std::vector<T, ArenaAllocator<T>> data;
 
 	public:
 
@@ -27,16 +56,32 @@ class Matrix {
 
 		// Constructors
 		// Empty constructor
-		Matrix() {}
+		Matrix() : rows(0), columns(0) {}
 
 		// Initializers
   		Matrix(const size_t x, const size_t y) : data(x * y), rows(x), columns(y) {}
 
-		Matrix(const size_t x, const size_t y, std::vector<T> contents) : data(contents), rows(x), columns(y) {}
+		Matrix(const size_t x, const size_t y, std::vector<T> contents) : data(contents.begin(), contents.end()), rows(x), columns(y) {}
 
 		// Get data vector
-		std::vector<T> getData() {
-			return data;
+		std::vector<T> getData() const {
+			return std::vector<T>(data.begin(), data.end());
+		}
+
+		// Row-major storage, element (r, c) is at r * columns + c as in operator^
+		inline T* raw() {
+			return data.data();
+		}
+
+		inline const T* raw() const {
+			return data.data();
+		}
+
+		// Keeps the allocation when shrinking, so buffers can be reused across batches
+		void resize(const size_t x, const size_t y) {
+			rows = x;
+			columns = y;
+			data.resize(x * y);
 		}
 
 		// Matrix read and write
@@ -77,13 +122,51 @@ class Matrix {
 			file.close();
 		}
 
+		// Enough digits that reading the text back gives the same T
 		void writeToFile(std::ofstream &file) {
+			file.precision(std::numeric_limits<T>::max_digits10);
 			file << rows << " " << columns << " ";
 			for (auto i : data) {
 				file << i << " ";
 			}
 		}
 
+		void writeBinary(const std::string &filename) const {
+			std::ofstream file(filename, std::ios::binary);
+			if (!file) {
+				std::cerr << "Error writing file" << std::endl;
+				throw "Error writing file";
+			}
+			MatrixHeader header(rows, columns, sizeof(T));
+			file.write((const char*) &header, sizeof(header));
+			file.write((const char*) data.data(), data.size() * sizeof(T));
+		}
+
+		// Converts between float and double files
+		static Matrix<T> readBinary(const std::string &filename) {
+			std::ifstream file(filename, std::ios::binary);
+			MatrixHeader header;
+			if (!file || !file.read((char*) &header, sizeof(header)) || !header.valid()) {
+				std::cerr << "Not a binary matrix: " << filename << std::endl;
+				throw "Error reading file";
+			}
+			Matrix<T> m(header.rows, header.columns);
+			if (header.scalarSize == sizeof(T)) {
+				file.read((char*) m.data.data(), m.data.size() * sizeof(T));
+			} else if (header.scalarSize == sizeof(float)) {
+				std::vector<float> temp(m.data.size());
+				file.read((char*) temp.data(), temp.size() * sizeof(float));
+				std::copy(temp.begin(), temp.end(), m.data.begin());
+			} else {
+				std::vector<double> temp(m.data.size());
+				file.read((char*) temp.data(), temp.size() * sizeof(double));
+				std::copy(temp.begin(), temp.end(), m.data.begin());
+			}
+			if (!file)
+				throw "Truncated binary matrix";
+			return m;
+		}
+
 		// Random
 
 		static Matrix<T> initializeRandom(const size_t rows, const size_t columns, const T min=-1, const T max=1) {
@@ -128,6 +211,63 @@ class Matrix {
 			return Matrix<T>(rows, m.columns, newData);
 		}
 
+		// Copy rows indices[0..n) of m into the first n rows of this matrix
+		template<typename I>
+		void gatherRows(const Matrix<T>& m, const I* indices, const size_t n) {
+			resize(n, m.columns);
+			for (size_t s = 0; s < n; s++)
+				std::copy(m.data.begin() + indices[s] * m.columns, m.data.begin() + (indices[s] + 1) * m.columns, data.begin() + s * m.columns);
+		}
+
+		// C = op(A) op(B) + beta * C into a preallocated C, op transposes when requested
+		static void gemm(const Matrix<T>& A, const Matrix<T>& B, Matrix<T>& C, const bool transA = false, const bool transB = false, const T beta = 0) {
+			const size_t m = transA ? A.columns : A.rows;
+			const size_t k = transA ? A.rows : A.columns;
+			const size_t n = transB ? B.rows : B.columns;
+			const T* a = A.data.data();
+			const T* b = B.data.data();
+			T* c = C.data.data();
+
+			if (beta == 0)
+				std::fill(C.data.begin(), C.data.end(), T(0));
+			else if (beta != 1)
+				for (size_t i = 0; i < m * n; i++)
+					c[i] *= beta;
+
+			// Loop orders keep the innermost loop on contiguous memory
+			if (!transA && !transB) {
+				for (size_t i = 0; i < m; i++)
+					for (size_t p = 0; p < k; p++) {
+						const T aip = a[i * k + p];
+						for (size_t j = 0; j < n; j++)
+							c[i * n + j] += aip * b[p * n + j];
+					}
+			} else if (!transA && transB) {
+				for (size_t i = 0; i < m; i++)
+					for (size_t j = 0; j < n; j++) {
+						T sum = 0;
+						for (size_t p = 0; p < k; p++)
+							sum += a[i * k + p] * b[j * k + p];
+						c[i * n + j] += sum;
+					}
+			} else if (transA && !transB) {
+				for (size_t p = 0; p < k; p++)
+					for (size_t i = 0; i < m; i++) {
+						const T api = a[p * m + i];
+						for (size_t j = 0; j < n; j++)
+							c[i * n + j] += api * b[p * n + j];
+					}
+			} else {
+				for (size_t i = 0; i < m; i++)
+					for (size_t j = 0; j < n; j++) {
+						T sum = 0;
+						for (size_t p = 0; p < k; p++)
+							sum += a[p * m + i] * b[j * k + p];
+						c[i * n + j] += sum;
+					}
+			}
+		}
+
 		// Hadamard product
 		Matrix<T> operator*(const Matrix<T>& m) const {
 			std::vector<T> newData(rows * columns);
@@ -262,7 +402,18 @@ class Matrix {
 		}
 
 		Matrix<T> reshape(const int i, const int j) const {
-			return Matrix<T>(i, j, data);
+			Matrix<T> m(*this);
+			m.rows = i;
+			m.columns = j;
+			return m;
+		}
+
+		// Same matrix with scalar type S
+		template<typename S>
+		Matrix<S> cast() const {
+			Matrix<S> m(rows, columns);
+			std::copy(data.begin(), data.end(), m.raw());
+			return m;
 		}
 
 		// Retrieve row or column
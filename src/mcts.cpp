@@ -0,0 +1,249 @@
+#ifndef MCTS_SEARCH
+#define MCTS_SEARCH
+#include "gamestate.cpp"
+#include "threadpool.cpp"
+#include <vector>
+#include <tuple>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <cmath>
+
+
+// Tree-parallel Monte Carlo tree search. E needs a Scalar type and evaluate(Matrix<Scalar>) scoring
+// a board for the player who just moved, it is called from several threads at once.
+// The value of a new node is its network value, and the values of the children
+// at expansion are also their priors.
+template<typename E>
+class MCTS {
+
+	private:
+
+		enum State : int { LEAF, EXPANDING, EXPANDED };
+
+		struct Node {
+			std::atomic<int> visits;
+			std::atomic<int> virtualLoss;
+			// Sum of values in fixed point, for the player who moved into this node
+			std::atomic<long long> valueSum;
+			std::atomic<int> state;
+			int firstChild;
+			int numChildren;
+			int move;
+			float value;
+			float prior;
+
+			void reset(int m, float v, float p) {
+				visits.store(0, std::memory_order_relaxed);
+				virtualLoss.store(0, std::memory_order_relaxed);
+				valueSum.store(0, std::memory_order_relaxed);
+				state.store(LEAF, std::memory_order_relaxed);
+				firstChild = -1;
+				numChildren = 0;
+				move = m;
+				value = v;
+				prior = p;
+			}
+		};
+
+		constexpr static double fixedPoint = 1 << 20;
+		constexpr static int virtualLossWeight = 1;
+
+		E* evaluator;
+		ThreadPool workers;
+		std::unique_ptr<Node[]> pool;
+		size_t capacity;
+		std::atomic<size_t> used;
+
+		int root = -1;
+		GameState rootState;
+
+		inline double q(const Node& n) const {
+			int visits = n.visits.load(std::memory_order_relaxed);
+			int loss = n.virtualLoss.load(std::memory_order_relaxed) * virtualLossWeight;
+			if (visits + loss == 0)
+				return n.value;
+			return (n.valueSum.load(std::memory_order_relaxed) / fixedPoint - loss) / (visits + loss);
+		}
+
+		int select(const Node& parent) const {
+			double sqrtParent = std::sqrt((double) parent.visits.load(std::memory_order_relaxed) + 1);
+			int best = parent.firstChild;
+			double bestScore = -1e9;
+			for (int k = parent.firstChild; k < parent.firstChild + parent.numChildren; k++) {
+				const Node& child = pool[k];
+				int visits = child.visits.load(std::memory_order_relaxed) + child.virtualLoss.load(std::memory_order_relaxed);
+				double score = q(child) + exploration * child.prior * sqrtParent / (1 + visits);
+				if (score > bestScore) {
+					bestScore = score;
+					best = k;
+				}
+			}
+			return best;
+		}
+
+		// Only the thread that wins the LEAF -> EXPANDING exchange allocates the children
+		void expand(Node& node, const GameState& s) {
+			int expected = LEAF;
+			if (!node.state.compare_exchange_strong(expected, EXPANDING, std::memory_order_acquire))
+				return;
+
+			int c = s.getColour();
+			auto moves = s.validMoves(c);
+			// Reserve the children only if they fit, so a full pool does not keep growing used
+			size_t first = used.load(std::memory_order_relaxed);
+			do {
+				if (first + moves.size() > capacity) {
+					// Pool exhausted, the node stays a leaf
+					node.state.store(LEAF, std::memory_order_release);
+					return;
+				}
+			} while (!used.compare_exchange_weak(first, first + moves.size(), std::memory_order_relaxed));
+
+			std::vector<double> values(moves.size());
+			double maxValue = -1e9, total = 0;
+			for (unsigned int k = 0; k < moves.size(); k++) {
+				auto [i, j] = moves[k];
+				GameState child = s.potentialBoard(i, j, c);
+				values[k] = child.isFinal() ? terminalValue(child) : std::tanh(evaluator->evaluate(c*child.input<typename E::Scalar>())[0]);
+				maxValue = std::max(maxValue, values[k]);
+			}
+			for (auto v : values)
+				total += std::exp(priorTemperature * (v - maxValue));
+			for (unsigned int k = 0; k < moves.size(); k++) {
+				auto [i, j] = moves[k];
+				double prior = std::exp(priorTemperature * (values[k] - maxValue)) / total;
+				pool[first + k].reset(GameState::squareIndex(i, j), values[k], prior);
+			}
+
+			node.firstChild = first;
+			node.numChildren = moves.size();
+			node.state.store(EXPANDED, std::memory_order_release);
+		}
+
+		// Final result for the player who made the last move
+		static double terminalValue(const GameState& s) {
+			double score = -s.getColour() * s.getScore();
+			return score > 0 ? 1 : (score < 0 ? -1 : 0);
+		}
+
+		void playout() {
+			GameState s = rootState;
+			std::vector<int> path;
+			path.push_back(root);
+			int current = root;
+
+			while (pool[current].state.load(std::memory_order_acquire) == EXPANDED && !s.isFinal()) {
+				current = select(pool[current]);
+				pool[current].virtualLoss.fetch_add(1, std::memory_order_relaxed);
+				path.push_back(current);
+				int move = pool[current].move;
+				s.placePiece(move % BOARD_WIDTH, move / BOARD_WIDTH, s.getColour());
+			}
+
+			Node& leaf = pool[current];
+			double value = s.isFinal() ? terminalValue(s) : leaf.value;
+			if (!s.isFinal() && (leaf.visits.load(std::memory_order_relaxed) > 0 || current == root))
+				expand(leaf, s);
+
+			for (auto k = path.rbegin(); k != path.rend(); k++) {
+				Node& n = pool[*k];
+				n.valueSum.fetch_add((long long) (value * fixedPoint), std::memory_order_relaxed);
+				n.visits.fetch_add(1, std::memory_order_relaxed);
+				if (*k != root)
+					n.virtualLoss.fetch_sub(1, std::memory_order_relaxed);
+				value = -value;
+			}
+		}
+
+		void resetTree(const GameState& s) {
+			used.store(1);
+			root = 0;
+			pool[root].reset(-1, 0, 1);
+			rootState = s;
+		}
+
+		// Reuse the subtree of our last move and the opponent's reply if it is still in the pool
+		bool reuse(const GameState& s) {
+			if (root < 0 || used.load() > capacity / 2)
+				return false;
+			std::vector<std::tuple<int, GameState>> frontier = {{root, rootState}};
+			for (int depth = 0; depth < 2; depth++) {
+				std::vector<std::tuple<int, GameState>> next;
+				for (auto &[index, state] : frontier) {
+					Node& n = pool[index];
+					if (n.state.load(std::memory_order_acquire) != EXPANDED)
+						continue;
+					for (int k = n.firstChild; k < n.firstChild + n.numChildren; k++) {
+						GameState child = state.potentialBoard(pool[k].move % BOARD_WIDTH, pool[k].move / BOARD_WIDTH, state.getColour());
+						if (child.moves == s.moves && child.board.getData() == s.board.getData()) {
+							root = k;
+							rootState = s;
+							return true;
+						}
+						next.push_back({k, child});
+					}
+				}
+				frontier = next;
+			}
+			return false;
+		}
+
+		std::chrono::steady_clock::time_point start;
+
+	public:
+
+		double exploration = 1.5;
+		double priorTemperature = 4;
+		int playouts;
+
+		// Statistics of the last search
+		long completedPlayouts = 0;
+		double seconds = 0;
+
+		MCTS(E* e, int p = 10000, int threads = 0, size_t nodes = 1 << 19) : evaluator(e), workers(threads), pool(new Node[nodes]), capacity(nodes), used(0), playouts(p) {}
+
+		std::tuple<int, int> search(const GameState& s, int n) {
+			if (!reuse(s))
+				resetTree(s);
+			expand(pool[root], rootState);
+
+			start = std::chrono::steady_clock::now();
+			std::atomic<long> remaining(n);
+			size_t threads = workers.size();
+			workers.parallelFor(threads, [this, &remaining] (size_t) {
+				while (remaining.fetch_sub(1, std::memory_order_relaxed) > 0)
+					playout();
+			});
+			completedPlayouts = n;
+			seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			// Most visited child of the root
+			Node& r = pool[root];
+			int best = r.firstChild;
+			for (int k = r.firstChild; k < r.firstChild + r.numChildren; k++)
+				if (pool[k].visits.load() > pool[best].visits.load())
+					best = k;
+			int move = pool[best].move;
+			return {move % BOARD_WIDTH, move / BOARD_WIDTH};
+		}
+
+		std::tuple<int, int> predictMove(const GameState& s) {
+			return search(s, playouts);
+		}
+
+		double playoutsPerSecond() const {
+			return seconds > 0 ? completedPlayouts / seconds : 0;
+		}
+
+		inline size_t nodesUsed() const {
+			return used.load();
+		}
+
+		inline size_t threads() const {
+			return workers.size();
+		}
+
+};
+
+#endif
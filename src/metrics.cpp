@@ -0,0 +1,178 @@
+#ifndef METRICS
+#define METRICS
+#include "boundedqueue.cpp"
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+
+namespace Metrics {
+
+	// Network evaluations done by this thread, value networks count one per candidate move
+	inline thread_local unsigned long evaluations = 0;
+
+	inline double seconds(const std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+
+// What one competition worker did, padded so workers do not share a cache line
+struct alignas(64) WorkerMetrics {
+	long games = 0;
+	long positions = 0;
+	long evaluations = 0;
+	// Heap allocations inside games, only counted with TRACK_ALLOCATIONS
+	long allocations = 0;
+	// Time spent inside games
+	double busy = 0;
+};
+
+
+// Timing and throughput of one generation of Supervisor::evolve
+struct GenerationMetrics {
+	long generation = 0;
+	int threads = 0;
+	int players = 0;
+	// Wall time of every phase in seconds, benchmark is 0 when it did not run
+	double competition = 0;
+	double selection = 0;
+	double crossover = 0;
+	double mutation = 0;
+	double benchmark = 0;
+	double total = 0;
+	long games = 0;
+	long evaluations = 0;
+	long positions = 0;
+	// Scores after the competition, they accumulate over generations
+	double best = 0;
+	double mean = 0;
+	double stddev = 0;
+	// Busy time of the workers over threads times the competition time
+	double utilization = 0;
+	// Heap traffic of the whole generation and of the games alone, only counted with TRACK_ALLOCATIONS
+	long allocations = 0;
+	long allocatedBytes = 0;
+	long gameAllocations = 0;
+
+	inline double gamesPerSecond() const {
+		return competition > 0 ? games / competition : 0;
+	}
+
+	inline double evaluationsPerSecond() const {
+		return competition > 0 ? evaluations / competition : 0;
+	}
+
+	inline double positionsPerSecond() const {
+		return competition > 0 ? positions / competition : 0;
+	}
+
+	std::string json() const {
+		std::ostringstream s;
+		s << "{\"generation\":" << generation << ",\"threads\":" << threads << ",\"players\":" << players
+			<< ",\"competition\":" << competition << ",\"select\":" << selection << ",\"crossover\":" << crossover
+			<< ",\"mutate\":" << mutation << ",\"benchmark\":" << benchmark << ",\"total\":" << total
+			<< ",\"games\":" << games << ",\"evaluations\":" << evaluations << ",\"positions\":" << positions
+			<< ",\"games_per_sec\":" << gamesPerSecond() << ",\"evals_per_sec\":" << evaluationsPerSecond()
+			<< ",\"positions_per_sec\":" << positionsPerSecond() << ",\"best\":" << best << ",\"mean\":" << mean
+			<< ",\"stddev\":" << stddev << ",\"utilization\":" << utilization << ",\"allocations\":" << allocations
+			<< ",\"allocated_bytes\":" << allocatedBytes << ",\"game_allocations\":" << gameAllocations << "}";
+		return s.str();
+	}
+
+	static std::string csvHeader() {
+		return "generation,threads,players,competition,select,crossover,mutate,benchmark,total,games,evaluations,positions,"
+			"games_per_sec,evals_per_sec,positions_per_sec,best,mean,stddev,utilization,allocations,allocated_bytes,game_allocations";
+	}
+
+	std::string csv() const {
+		std::ostringstream s;
+		s << generation << ',' << threads << ',' << players << ',' << competition << ',' << selection << ',' << crossover
+			<< ',' << mutation << ',' << benchmark << ',' << total << ',' << games << ',' << evaluations << ',' << positions
+			<< ',' << gamesPerSecond() << ',' << evaluationsPerSecond() << ',' << positionsPerSecond()
+			<< ',' << best << ',' << mean << ',' << stddev << ',' << utilization << ',' << allocations << ',' << allocatedBytes << ',' << gameAllocations;
+		return s.str();
+	}
+
+	// One line for the console
+	std::string summary() const {
+		std::ostringstream s;
+		s << "Generation " << generation << ": " << total << " s, " << gamesPerSecond() << " games/s, "
+			<< evaluationsPerSecond() << " evals/s, best " << best << ", mean " << mean << " (" << stddev << "), "
+			<< 100 * utilization << "% utilization";
+		if (allocations)
+			s << ", " << allocations << " allocations (" << (games ? gameAllocations / games : 0) << " per game)";
+		return s.str();
+	}
+};
+
+
+// Writes GenerationMetrics as JSON lines, or CSV when the file ends in .csv.
+// log() never blocks: records are formatted and written by a background thread,
+// and dropped if that thread falls too far behind.
+class MetricsLogger {
+
+	private:
+
+		std::ofstream file;
+		bool csv;
+		BoundedQueue<GenerationMetrics> queue;
+		std::thread writer;
+		std::atomic<bool> stopping;
+
+		void work() {
+			while (true) {
+				bool stop = stopping.load(std::memory_order_acquire);
+				GenerationMetrics m;
+				bool any = false;
+				while (queue.pop(m)) {
+					file << (csv ? m.csv() : m.json()) << '\n';
+					written.fetch_add(1, std::memory_order_relaxed);
+					any = true;
+				}
+				if (any)
+					file.flush();
+				else if (stop)
+					break;
+				else
+					std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			}
+		}
+
+	public:
+
+		std::atomic<long> written;
+		std::atomic<long> dropped;
+
+		MetricsLogger(const std::string &filename) : queue(1 << 10), stopping(false), written(0), dropped(0) {
+			csv = filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".csv") == 0;
+			file.open(filename, std::ios::app);
+			if (!file) {
+				std::cerr << "Could not open " << filename << std::endl;
+				throw "Could not open metrics file";
+			}
+			if (csv && file.tellp() == 0)
+				file << GenerationMetrics::csvHeader() << '\n';
+			writer = std::thread(&MetricsLogger::work, this);
+		}
+
+		MetricsLogger(const MetricsLogger&) = delete;
+		MetricsLogger& operator=(const MetricsLogger&) = delete;
+
+		void log(const GenerationMetrics &m) {
+			if (!queue.push(m))
+				dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		// Writes what is still queued
+		~MetricsLogger() {
+			stopping.store(true, std::memory_order_release);
+			writer.join();
+		}
+};
+
+#endif
@@ -5,11 +5,16 @@
 #include <algorithm>
 #include <cmath>
 #include "activators.cpp"
+#include "metrics.cpp"
+#include "instrument.cpp"
+#include "trace.cpp"
 #include <functional>
 #include <utility>
 #include <numeric>
 #include <fstream>
 #include <string>
+#include <random>
+#include <chrono>
 
 
 template<typename T>
@@ -29,6 +34,8 @@ class NeuralNetwork {
 
 	public:
 
+		using Scalar = T;
+
 		VectorMatrix weights;
 		VectorMatrix biases;
 
@@ -64,12 +71,282 @@ class NeuralNetwork {
 
 		Matrix<T> evaluate(Matrix<T> m){
 
+			INSTRUMENT_SCOPE(evaluate);
+			Metrics::evaluations++;
 			for (unsigned int i = 0; i < weights.size(); i++)
 				m = activations[i]((weights[i] ^ m) + biases[i]);
 
 			return m;
 		}
 
+		// Buffers for one minibatch, samples are the rows of every matrix
+		struct Workspace {
+			VectorMatrix z;
+			VectorMatrix a;
+			VectorMatrix delta;
+			VectorMatrix nablaW;
+			VectorMatrix nablaB;
+			size_t batch = 0;
+		};
+
+		Workspace workspace(const size_t batch) const {
+			Workspace w;
+			for (unsigned int i = 0; i < weights.size(); i++) {
+				w.nablaW.push_back(Matrix<T>(weights[i].rows, weights[i].columns));
+				w.nablaB.push_back(Matrix<T>(biases[i].rows, biases[i].columns));
+			}
+			w.z.resize(weights.size());
+			w.delta.resize(weights.size());
+			w.a.resize(weights.size() + 1);
+			resizeWorkspace(w, batch);
+			return w;
+		}
+
+		void resizeWorkspace(Workspace& w, const size_t batch) const {
+			if (w.batch == batch)
+				return;
+			w.batch = batch;
+			w.a[0].resize(batch, inputSize);
+			for (unsigned int i = 0; i < weights.size(); i++) {
+				w.z[i].resize(batch, weights[i].rows);
+				w.a[i + 1].resize(batch, weights[i].rows);
+				w.delta[i].resize(batch, weights[i].rows);
+			}
+		}
+
+		inline const Function<T>* layerFunction(const unsigned int i) const {
+			return i + 1 == weights.size() ? finalFunction : activationFunction;
+		}
+
+		// Whole batch through each layer as one GEMM, X is batch x inputSize
+		const Matrix<T>& forward(const Matrix<T>& X, Workspace& w) const {
+			return forward(X.raw(), X.rows, w);
+		}
+
+		// Same with the batch as rows * inputSize values, such as a Dataset batch
+		const Matrix<T>& forward(const T* X, const size_t rows, Workspace& w) const {
+			Trace::Span span("forward", "rows", rows);
+			resizeWorkspace(w, rows);
+			std::copy(X, X + rows * inputSize, w.a[0].raw());
+			for (unsigned int i = 0; i < weights.size(); i++) {
+				Matrix<T>& z = w.z[i];
+				Matrix<T>::gemm(w.a[i], weights[i], z, false, true);
+				T* zr = z.raw();
+				const T* b = biases[i].raw();
+				for (size_t s = 0; s < z.rows; s++)
+					for (size_t j = 0; j < z.columns; j++)
+						zr[s * z.columns + j] += b[j];
+				layerFunction(i)->forward(zr, w.a[i + 1].raw(), z.size());
+			}
+			return w.a.back();
+		}
+
+		Matrix<T> evaluateBatch(const Matrix<T>& X) const {
+			Workspace w = workspace(X.rows);
+			return forward(X, w);
+		}
+
+		// Gradients of the summed squared error over the batch into w.nablaW and w.nablaB
+		void backward(const Matrix<T>& Y, Workspace& w) const {
+			backward(Y.raw(), w);
+		}
+
+		void backward(const T* y, Workspace& w) const {
+			int last = weights.size() - 1;
+			Matrix<T>& out = w.delta[last];
+			const T* a = w.a.back().raw();
+			T* d = out.raw();
+			for (size_t i = 0; i < out.size(); i++)
+				d[i] = a[i] - y[i];
+
+			for (int i = last; i >= 0; i--) {
+				layerFunction(i)->backward(w.z[i].raw(), w.delta[i].raw(), w.delta[i].size());
+				Matrix<T>::gemm(w.delta[i], w.a[i], w.nablaW[i], true, false);
+				T* nb = w.nablaB[i].raw();
+				const T* di = w.delta[i].raw();
+				size_t n = w.delta[i].columns;
+				std::fill(nb, nb + n, T(0));
+				for (size_t s = 0; s < w.delta[i].rows; s++)
+					for (size_t j = 0; j < n; j++)
+						nb[j] += di[s * n + j];
+				if (i > 0)
+					Matrix<T>::gemm(w.delta[i], weights[i], w.delta[i - 1]);
+			}
+		}
+
+		void applyGradients(const VectorMatrix& nablaW, const VectorMatrix& nablaB, const T rate) {
+			for (unsigned int i = 0; i < weights.size(); i++) {
+				T* wr = weights[i].raw();
+				const T* nw = nablaW[i].raw();
+				for (size_t j = 0; j < weights[i].size(); j++)
+					wr[j] -= rate * nw[j];
+				T* br = biases[i].raw();
+				const T* nb = nablaB[i].raw();
+				for (size_t j = 0; j < biases[i].size(); j++)
+					br[j] -= rate * nb[j];
+			}
+		}
+
+		// Only touches non-zero gradients, for asynchronous updates with sparse inputs
+		void applySparseGradients(const VectorMatrix& nablaW, const VectorMatrix& nablaB, const T rate) {
+			for (unsigned int i = 0; i < weights.size(); i++) {
+				T* wr = weights[i].raw();
+				const T* nw = nablaW[i].raw();
+				for (size_t j = 0; j < weights[i].size(); j++)
+					if (nw[j] != 0)
+						wr[j] -= rate * nw[j];
+				T* br = biases[i].raw();
+				const T* nb = nablaB[i].raw();
+				for (size_t j = 0; j < biases[i].size(); j++)
+					if (nb[j] != 0)
+						br[j] -= rate * nb[j];
+			}
+		}
+
+		void updateBatch(const Matrix<T>& X, const Matrix<T>& Y, const T eta, Workspace& w) {
+			updateBatch(X.raw(), Y.raw(), X.rows, eta, w);
+		}
+
+		void updateBatch(const T* X, const T* Y, const size_t rows, const T eta, Workspace& w) {
+			forward(X, rows, w);
+			backward(Y, w);
+			applyGradients(w.nablaW, w.nablaB, eta / rows);
+			if (reduceToThresholdOrVoidNAN()) {
+				std::cout << "Reduction was necessary" << std::endl;
+			}
+		}
+
+		// X is samples x inputSize, Y samples x outputSize, returns samples per second
+		double train(const Matrix<T>& X, const Matrix<T>& Y, const int epochs, const size_t batchSize, const T eta, const bool verbose = false) {
+
+			std::vector<size_t> indices(X.rows);
+			std::iota(indices.begin(), indices.end(), 0);
+			std::default_random_engine generator(time(0));
+			Workspace w = workspace(batchSize);
+			Matrix<T> batchX(batchSize, X.columns), batchY(batchSize, Y.columns);
+			auto start = std::chrono::steady_clock::now();
+
+			for (int i = 0; i < epochs; i++) {
+
+				std::shuffle(indices.begin(), indices.end(), generator);
+
+				for (size_t j = 0; j < indices.size(); j += batchSize) {
+					size_t size = std::min(batchSize, indices.size() - j);
+					batchX.gatherRows(X, &indices[j], size);
+					batchY.gatherRows(Y, &indices[j], size);
+					updateBatch(batchX, batchY, eta, w);
+				}
+
+				if (verbose) {
+					std::cout << "At epoch " << i+1 << " of " << epochs << std::endl;
+				}
+			}
+
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			double rate = seconds > 0 ? epochs * X.rows / seconds : 0;
+			if (verbose) {
+				std::cout << "Samples/sec: " << rate << std::endl;
+			}
+			return rate;
+		}
+
+		// Same interface as the old trainer, every sample a column vector
+		double train(const VectorMatrix& data, const VectorMatrix& target, const int epochs, const size_t batchSize, const T eta, const bool verbose = false) {
+			return train(stack(data), stack(target), epochs, batchSize, eta, verbose);
+		}
+
+		static Matrix<T> stack(const VectorMatrix& samples) {
+			size_t n = samples.empty() ? 0 : samples[0].size();
+			Matrix<T> result(samples.size(), n);
+			for (size_t s = 0; s < samples.size(); s++)
+				std::copy(samples[s].raw(), samples[s].raw() + n, result.raw() + s * n);
+			return result;
+		}
+
+		// Per-sample backpropagation as in old/neural-network.cpp, kept as reference for the batched version
+		void updateNablas(const Matrix<T>& data, const Matrix<T>& target, VectorMatrix& nabla_b, VectorMatrix& nabla_w) {
+
+			VectorMatrix activated, results;
+			activated.reserve(weights.size() + 1);
+			activated.push_back(data);
+			results.reserve(weights.size());
+
+			for (unsigned int i = 0; i < biases.size(); i++) {
+				results.push_back((weights[i] ^ activated.back()) + biases[i]);
+				activated.push_back(activations[i](results.back()));
+			}
+
+			Matrix<T> delta = (activated.back() - target) * (derivatives.back())(results.back());
+			nabla_b.back() += delta;
+			nabla_w.back() += delta ^ activated[activated.size() - 2].transpose();
+
+			for (int i = results.size() - 2; i >= 0; i--) {
+				delta = (weights[i + 1].transpose() ^ delta) * derivatives[i](results[i]);
+				nabla_b[i] += delta;
+				nabla_w[i] += delta ^ activated[i].transpose();
+			}
+		}
+
+		void updateBatchPerSample(const VectorMatrix& data, const VectorMatrix& target, T eta) {
+
+			VectorMatrix nabla_b, nabla_w;
+			for (unsigned int i = 0; i < biases.size(); i++) {
+				nabla_b.push_back(Matrix<T>(biases[i].rows, biases[i].columns));
+				nabla_w.push_back(Matrix<T>(weights[i].rows, weights[i].columns));
+			}
+
+			for (unsigned int i = 0; i < data.size(); i++) {
+				updateNablas(data[i], target[i], nabla_b, nabla_w);
+			}
+
+			applyGradients(nabla_w, nabla_b, eta / data.size());
+		}
+
+		bool reduceToThresholdOrVoidNAN() {
+			bool detected = false;
+			for (auto layers : {&weights, &biases}) {
+				for (auto &m : *layers) {
+					for (unsigned int j = 0; j < m.size(); j++) {
+						if (m[j] > threshold || m[j] < -threshold || std::isnan(m[j])) {
+							m[j] = std::signbit(m[j]) ? 1 - threshold : threshold - 1;
+							detected = true;
+						}
+					}
+				}
+			}
+			return detected;
+		}
+
+		// All weights then all biases as one flat vector
+		size_t parameterCount() const {
+			size_t n = 0;
+			for (unsigned int i = 0; i < weights.size(); i++)
+				n += weights[i].size() + biases[i].size();
+			return n;
+		}
+
+		void getParameters(T* out) const {
+			for (auto layers : {&weights, &biases})
+				for (auto &m : *layers)
+					out = std::copy(m.raw(), m.raw() + m.size(), out);
+		}
+
+		void setParameters(const T* in) {
+			for (auto layers : {&weights, &biases})
+				for (auto &m : *layers) {
+					std::copy(in, in + m.size(), m.raw());
+					in += m.size();
+				}
+		}
+
+		inline size_t getInputSize() const {
+			return inputSize;
+		}
+
+		inline size_t getOutputSize() const {
+			return outputSize;
+		}
+
 	void saveNetwork(const std::string &filename) const {
 		/*
 		* Save file layout:
@@ -79,6 +356,8 @@ class NeuralNetwork {
 		* weights, biases
 		* avID, fID
 		* File extension: .ssvn
+		* Value and policy networks share this layout, they only
+		* differ in outputSize (1 or one logit per square)
 		*/
 		std::ofstream file;
 		try {
@@ -113,8 +392,18 @@ class NeuralNetwork {
 			throw "Error reading file";
 		}
 
-		// Ignore magic SSVN
-		file.ignore(4, ' ');
+		std::string magic;
+		file >> magic;
+		if (!file.is_open() || magic != "SSVN") {
+			std::cerr << "Not a network file: " << filename << std::endl;
+			throw "Error reading file";
+		}
+
+		// Replaces the layers of a network that was already set up
+		weights.clear();
+		biases.clear();
+		activations.clear();
+		derivatives.clear();
 
 		// Initialize weights and biases
 		int numLayers;
@@ -0,0 +1,227 @@
+#ifndef NTUPLENETWORK
+#define NTUPLENETWORK
+#include "matrix.cpp"
+#include "metrics.cpp"
+#include <vector>
+#include <tuple>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+
+template<typename T>
+class NTupleNetwork {
+	using VectorMatrix = typename std::vector<Matrix<T>>;
+	private:
+
+		constexpr static int width = 8;
+		constexpr static int squares = width * width;
+
+		// Square indices of every pattern, before applying symmetries
+		std::vector<std::vector<int>> patterns;
+
+		// Every symmetric copy of a pattern, and the table it reads from
+		std::vector<std::vector<int>> instances;
+		std::vector<int> instanceTable;
+
+		// For every square the (instance, 3^k) pairs it contributes to
+		std::vector<std::vector<std::tuple<int, int>>> squareInstances;
+
+		static int transform(const int square, const int symmetry) {
+			int i = square % width, j = square / width, k = width - 1;
+			int ti, tj;
+			switch (symmetry) {
+				case 0: ti = i; tj = j; break;
+				case 1: ti = j; tj = i; break;
+				case 2: ti = k - i; tj = j; break;
+				case 3: ti = i; tj = k - j; break;
+				case 4: ti = k - i; tj = k - j; break;
+				case 5: ti = k - j; tj = i; break;
+				case 6: ti = j; tj = k - i; break;
+				default: ti = k - j; tj = k - i; break;
+			}
+			return ti + tj * width;
+		}
+
+		static inline int digit(const double x) {
+			return x > 0 ? 2 : (x < 0 ? 0 : 1);
+		}
+
+		void buildInstances() {
+			instances.clear();
+			instanceTable.clear();
+			squareInstances.assign(squares, {});
+			// Square sets of the instances so far, a symmetry can map a pattern onto itself in another order
+			std::vector<std::vector<int>> covered;
+			for (unsigned int p = 0; p < patterns.size(); p++) {
+				for (int s = 0; s < 8; s++) {
+					std::vector<int> instance;
+					for (auto square : patterns[p])
+						instance.push_back(transform(square, s));
+					std::vector<int> set = instance;
+					std::sort(set.begin(), set.end());
+					if (std::find(covered.begin(), covered.end(), set) != covered.end())
+						continue;
+					covered.push_back(set);
+					int index = instances.size();
+					int power = 1;
+					for (auto square : instance) {
+						squareInstances[square].push_back({index, power});
+						power *= 3;
+					}
+					instances.push_back(instance);
+					instanceTable.push_back(p);
+				}
+			}
+		}
+
+	public:
+
+		using Scalar = T;
+
+		// One lookup table of 3^k cells per pattern, shared by all its symmetric instances
+		VectorMatrix weights;
+		VectorMatrix biases;
+
+		NTupleNetwork() : NTupleNetwork(defaultPatterns()) {}
+
+		NTupleNetwork(const std::string &filename) {
+			std::cout << "Initializing from filename" << std::endl;
+			readNetwork(filename);
+		}
+
+		NTupleNetwork(const std::vector<std::vector<int>> &p, const T min = -0.1, const T max = 0.1) : patterns(p) {
+			for (auto &pattern : patterns) {
+				size_t cells = 1;
+				for (unsigned int k = 0; k < pattern.size(); k++)
+					cells *= 3;
+				weights.push_back(Matrix<T>::initializeRandom(cells, 1, min, max));
+			}
+			biases.push_back(Matrix<T>::initializeRandom(1, 1, min, max));
+			buildInstances();
+		}
+
+		static std::vector<std::vector<int>> defaultPatterns() {
+			// Corner 3x3, edge row, second row and main diagonal
+			return {
+				{0, 1, 2, 8, 9, 10, 16, 17, 18},
+				{0, 1, 2, 3, 4, 5, 6, 7},
+				{8, 9, 10, 11, 12, 13, 14, 15},
+				{0, 9, 18, 27, 36, 45, 54, 63}
+			};
+		}
+
+		// Full evaluation, same interface as NeuralNetwork, the board can have any scalar type
+		template<typename S>
+		Matrix<T> evaluate(const Matrix<S> &m) const {
+			return Matrix<T>(1, 1, {(T) value(indices(m))});
+		}
+
+		template<typename S>
+		std::vector<int> indices(const Matrix<S> &m) const {
+			std::vector<int> result(instances.size(), 0);
+			for (int square = 0; square < squares; square++) {
+				int d = digit(m[square]);
+				for (auto [instance, power] : squareInstances[square])
+					result[instance] += d * power;
+			}
+			return result;
+		}
+
+		double value(const std::vector<int> &idx) const {
+			Metrics::evaluations++;
+			double result = biases[0][0];
+			for (unsigned int i = 0; i < idx.size(); i++)
+				result += weights[instanceTable[i]][idx[i]];
+			return result;
+		}
+
+		// Incremental update of the indices when a square changes from one value to another
+		void updateIndices(std::vector<int> &idx, const int square, const double from, const double to) const {
+			int change = digit(to) - digit(from);
+			if (!change)
+				return;
+			for (auto [instance, power] : squareInstances[square])
+				idx[instance] += change * power;
+		}
+
+		// Squares of every instance, digit k of its index is the k-th square
+		inline const std::vector<std::vector<int>>& getInstances() const {
+			return instances;
+		}
+
+		inline size_t numInstances() const {
+			return instances.size();
+		}
+
+	void saveNetwork(const std::string &filename) const {
+		/*
+		* Save file layout:
+		* Magic: SSVT
+		* numPatterns
+		* per pattern: length, squares
+		* tables, bias
+		* File extension: .ssvt
+		*/
+		std::ofstream file;
+		try {
+			file.open(filename);
+		} catch (const std::ofstream::failure &e) {
+			std::cerr << "Error reading file" << std::endl;
+			throw "Error writing file";
+		}
+
+		file << "SSVT ";
+		file << patterns.size() << " ";
+		for (auto &pattern : patterns) {
+			file << pattern.size() << " ";
+			for (auto square : pattern)
+				file << square << " ";
+		}
+
+		for (auto w : weights) {
+			w.writeToFile(file);
+		}
+		for (auto b : biases) {
+			b.writeToFile(file);
+		}
+		file.close();
+	}
+
+	void readNetwork(const std::string &filename) {
+		std::ifstream file;
+		try {
+			file.open(filename);
+		} catch (const std::ifstream::failure &e) {
+			std::cerr << "Error reading file" << std::endl;
+			throw "Error reading file";
+		}
+
+		// Ignore magic SSVT
+		file.ignore(4, ' ');
+
+		size_t numPatterns;
+		file >> numPatterns;
+		patterns.assign(numPatterns, {});
+		for (auto &pattern : patterns) {
+			size_t length;
+			file >> length;
+			pattern.resize(length);
+			for (auto &square : pattern)
+				file >> square;
+		}
+
+		weights.clear();
+		biases.clear();
+		for (size_t i = 0; i < numPatterns; i++)
+			weights.push_back(Matrix<T>::readFromFile(file));
+		biases.push_back(Matrix<T>::readFromFile(file));
+
+		buildInstances();
+		file.close();
+	}
+
+};
+
+#endif
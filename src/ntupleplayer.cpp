@@ -0,0 +1,72 @@
+#ifndef NTUPLEPLAYER
+#define NTUPLEPLAYER
+#include "gamestate.cpp"
+#include <vector>
+#include <string>
+#include <tuple>
+#include "ntuple-network.cpp"
+#include "player.cpp"
+
+
+class NTuplePlayer : public NTupleNetwork<float>, public Player<NTuplePlayer> {
+
+	public:
+
+		NTuplePlayer() : NTupleNetwork() {}
+
+		NTuplePlayer(const std::vector<std::vector<int>> &patterns) : NTupleNetwork(patterns) {}
+
+		NTuplePlayer(const std::string &filename) : NTupleNetwork(filename) {}
+
+		NTuplePlayer(const NTuplePlayer &old) : NTupleNetwork<float>(old), Player<NTuplePlayer>(old) {}
+
+		// idx indexes c*s, afterwards it indexes the board after c plays (x, y). Only the
+		// placed square and the squares it flips are touched, found the way placePiece does
+		void applyMove(std::vector<int> &idx, const GameState& s, const int x, const int y, const int c) const {
+			updateIndices(idx, GameState::squareIndex(x, y), 0, 1);
+			for (int di = -1; di < 2; di++) {
+				for (int dj = -1; dj < 2; dj++) {
+					if (di == 0 && dj == 0)
+						continue;
+					auto [fi, fj] = s.getFlip(x, y, di, dj, c);
+					if (fi == x && fj == y)
+						continue;
+					for (int i = x + di, j = y + dj; i != fi || j != fj; i += di, j += dj) {
+						double v = c*s.board(i, j);
+						updateIndices(idx, GameState::squareIndex(i, j), v, -v);
+					}
+				}
+			}
+		}
+
+		std::tuple<int, int> predictMove(const GameState& s) {
+
+			if (inEndgame(s))
+				return endgameMove(s);
+
+			// Index the current board once, every candidate only updates the squares it changes
+			int c = s.getColour();
+			auto moves = s.validMoves(c);
+			std::vector<int> base = indices(c*s.input());
+			double m = 0;
+			int r = 0;
+
+			for (unsigned int i = 0; i < moves.size(); i++) {
+
+				auto [x, y] = moves[i];
+				std::vector<int> idx = base;
+				applyMove(idx, s, x, y, c);
+				double p = value(idx);
+
+				if (i == 0 || p > m) {
+					m = p;
+					r = i;
+				}
+			}
+
+			return moves[r];
+		}
+
+};
+
+#endif
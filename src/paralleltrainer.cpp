@@ -0,0 +1,117 @@
+#ifndef PARALLELTRAINER
+#define PARALLELTRAINER
+#include "neural-network.cpp"
+#include "threadpool.cpp"
+#include <vector>
+#include <random>
+#include <chrono>
+#include <numeric>
+#include <algorithm>
+#include <iostream>
+
+
+// Data-parallel minibatch SGD on the thread pool.
+// Synchronous: every minibatch is sharded over the threads, the per-thread
+// gradients are summed with a tree reduction and applied once.
+// Hogwild: every thread trains on its own minibatches and writes its sparse
+// updates to the shared weights without any synchronisation.
+template<typename T>
+class ParallelTrainer {
+
+	using Workspace = typename NeuralNetwork<T>::Workspace;
+
+	private:
+
+		NeuralNetwork<T>* network;
+		ThreadPool pool;
+		std::vector<Workspace> workspaces;
+		std::vector<Matrix<T>> shardX;
+		std::vector<Matrix<T>> shardY;
+
+		void reduce(const size_t shards) {
+			for (size_t stride = 1; stride < shards; stride *= 2) {
+				size_t pairs = (shards + 2 * stride - 1) / (2 * stride);
+				pool.parallelFor(pairs, [this, stride, shards] (size_t p) {
+					size_t to = p * 2 * stride, from = to + stride;
+					if (from >= shards)
+						return;
+					for (unsigned int i = 0; i < workspaces[to].nablaW.size(); i++) {
+						workspaces[to].nablaW[i] += workspaces[from].nablaW[i];
+						workspaces[to].nablaB[i] += workspaces[from].nablaB[i];
+					}
+				});
+			}
+		}
+
+	public:
+
+		ParallelTrainer(NeuralNetwork<T>* n, int threads = 0) : network(n), pool(threads) {
+			for (size_t t = 0; t < pool.size(); t++)
+				workspaces.push_back(network->workspace(0));
+			shardX.resize(pool.size());
+			shardY.resize(pool.size());
+		}
+
+		inline size_t threads() const {
+			return pool.size();
+		}
+
+		// One synchronous step on the rows indices[0..n) of X and Y
+		void step(const Matrix<T>& X, const Matrix<T>& Y, const size_t* indices, const size_t n, const T eta) {
+			size_t shards = std::min(pool.size(), n);
+			pool.parallelFor(shards, [&] (size_t t) {
+				size_t begin = t * n / shards, end = (t + 1) * n / shards;
+				shardX[t].gatherRows(X, indices + begin, end - begin);
+				shardY[t].gatherRows(Y, indices + begin, end - begin);
+				network->forward(shardX[t], workspaces[t]);
+				network->backward(shardY[t], workspaces[t]);
+			});
+			reduce(shards);
+			network->applyGradients(workspaces[0].nablaW, workspaces[0].nablaB, eta / n);
+		}
+
+		// Returns samples per second
+		double train(const Matrix<T>& X, const Matrix<T>& Y, const int epochs, const size_t batchSize, const T eta, const bool hogwild = false, const bool verbose = false) {
+
+			std::vector<size_t> indices(X.rows);
+			std::iota(indices.begin(), indices.end(), 0);
+			std::default_random_engine generator(time(0));
+			auto start = std::chrono::steady_clock::now();
+
+			for (int i = 0; i < epochs; i++) {
+
+				std::shuffle(indices.begin(), indices.end(), generator);
+
+				if (hogwild) {
+					size_t batches = (indices.size() + batchSize - 1) / batchSize;
+					pool.parallelFor(pool.size(), [&] (size_t t) {
+						for (size_t b = t; b < batches; b += pool.size()) {
+							size_t begin = b * batchSize, size = std::min(batchSize, indices.size() - begin);
+							shardX[t].gatherRows(X, &indices[begin], size);
+							shardY[t].gatherRows(Y, &indices[begin], size);
+							network->forward(shardX[t], workspaces[t]);
+							network->backward(shardY[t], workspaces[t]);
+							network->applySparseGradients(workspaces[t].nablaW, workspaces[t].nablaB, eta / size);
+						}
+					});
+				} else {
+					for (size_t j = 0; j < indices.size(); j += batchSize)
+						step(X, Y, &indices[j], std::min(batchSize, indices.size() - j), eta);
+				}
+
+				if (verbose) {
+					std::cout << "At epoch " << i+1 << " of " << epochs << std::endl;
+				}
+			}
+
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			double rate = seconds > 0 ? epochs * X.rows / seconds : 0;
+			if (verbose) {
+				std::cout << "Samples/sec: " << rate << std::endl;
+			}
+			return rate;
+		}
+
+};
+
+#endif
@@ -0,0 +1,228 @@
+#ifndef BASEPLAYER
+#define BASEPLAYER
+#include "gamestate.cpp"
+#include <vector>
+#include <tuple>
+#include <mutex>
+#include "randomgenerator.cpp"
+#include "endgame.cpp"
+#include "threadpool.cpp"
+#include <cmath>
+#include <atomic>
+
+
+// Result of a strength test, rates in percent of games
+struct StrengthEstimate {
+	double score = 0;
+	double wins = 0;
+	double loses = 0;
+	int games = 0;
+	// Half-width of the 95% confidence interval of the win rate
+	double margin = 0;
+};
+
+// Half-width of the 95% Wilson score interval of wins out of n
+inline double wilsonMargin(const int wins, const int n) {
+	if (n == 0)
+		return 1;
+	const double z = 1.96;
+	double p = (double) wins / n;
+	return z * std::sqrt(p * (1 - p) / n + z * z / (4.0 * n * n)) / (1 + z * z / n);
+}
+
+
+// Scoring and benchmarking shared by every evaluator that can play,
+// Derived has to provide predictMove(const GameState&)
+template<typename Derived>
+class Player {
+
+	private:
+
+		std::mutex *scoreMutex;
+		double score = 0;
+
+	public:
+
+		// With at most this many empty squares the endgame solver picks the move, 0 disables it
+		int endgameEmpties = 0;
+
+		Player() {
+			scoreMutex = new std::mutex();
+		}
+
+		Player(const Player &old) {
+			score = old.score;
+			endgameEmpties = old.endgameEmpties;
+			scoreMutex = new std::mutex();
+		}
+
+		Player& operator=(const Player &old) {
+			score = old.score;
+			endgameEmpties = old.endgameEmpties;
+			return *this;
+		}
+
+		void addScore(double change) {
+			scoreMutex->lock();
+			score += change;
+			scoreMutex->unlock();
+		}
+
+		void setScore(double nScore) {
+			scoreMutex->lock();
+			score = nScore;
+			scoreMutex->unlock();
+		}
+
+		double getScore() {
+			return score;
+		}
+
+		// Every move places a disc, so the move counter gives the empty squares without a scan
+		inline bool inEndgame(const GameState& s) const {
+			return endgameEmpties > 0 && BOARD_SIZE - s.moves <= endgameEmpties;
+		}
+
+		std::tuple<int, int> endgameMove(const GameState& s) {
+			// One solver per thread, competition workers call this concurrently
+			thread_local EndgameSolver solver;
+			return solver.bestMove(s);
+		}
+
+		// moves, if given, receives the square index of every move in order
+		static double eval(Derived* p1, Derived* p2, uint8_t* moves = nullptr) {
+
+			GameState board;
+
+			for (int k = 0; k < BOARD_SIZE/2 - 2; k++) {
+
+				auto [x1, y1] = p1->predictMove(board);
+				board.placePiece(x1, y1, 1);
+
+				auto [x2, y2] = p2->predictMove(board);
+				board.placePiece(x2, y2, -1);
+
+				if (moves) {
+					moves[2*k] = GameState::squareIndex(x1, y1);
+					moves[2*k + 1] = GameState::squareIndex(x2, y2);
+				}
+			}
+			return board.getScore();
+
+		}
+
+		std::tuple<int, int, int> randomBenchmarkerSingle() {
+
+			Derived* self = static_cast<Derived*>(this);
+			GameState white;
+			GameState black;
+
+			for (int k= 0; k < BOARD_SIZE/2-2; k++) {
+
+				// White AI
+				auto [x1, y1] = self->predictMove(white);
+				white.placePiece(x1, y1, 1);
+
+				// White Random
+				std::vector<std::tuple<int, int>> moves1 = white.validMoves(-1);
+				std::uniform_int_distribution<int> distribution1(0, moves1.size()-1);
+				auto [i1, j1] = moves1[distribution1(RandomGenerator::generator)];
+				white.placePiece(i1, j1, -1);
+
+				// Black Random
+				std::vector<std::tuple<int, int>> moves2 = black.validMoves(1);
+				std::uniform_int_distribution<int> distribution2(0, moves2.size()-1);
+				auto [i2, j2] = moves2[distribution2(RandomGenerator::generator)];
+				black.placePiece(i2, j2, 1);
+
+				// Black AI
+				auto [x2, y2] = self->predictMove(black);
+				black.placePiece(x2, y2, -1);
+			}
+
+			int whiteScore = white.getScore();
+			int blackScore = black.getScore() * -1;
+			int wins = (whiteScore > 0 ? 1 : 0) + (blackScore > 0 ? 1 : 0);
+			int loses = (whiteScore < 0 ? 1 : 0) + (blackScore < 0 ? 1 : 0);
+
+			return {(whiteScore + blackScore), wins, loses};
+		}
+
+		std::tuple<double, double, double> randomBenchmarker(int n = 1000) {
+			int result = 0;
+			int wins = 0;
+			int loses = 0;
+			for (int i = 0; i < n; i++) {
+				auto [score, win, lose] = randomBenchmarkerSingle();
+				result += score;
+				wins += win;
+				loses += lose;
+			}
+			return {(double) result / ((double)n * 2), (double)wins/((double)n * 2) * 100, (double) loses / ((double) n*2) * 100};
+		}
+
+		// randomBenchmarker on the threads of a pool, each with its own generator. Stops after at most
+		// n rounds of two games, or as soon as the 95% confidence interval of the win rate is
+		// narrower than plus or minus margin, but not before minRounds rounds.
+		StrengthEstimate randomBenchmarker(ThreadPool& pool, int n = 1000, double margin = 0.02, int minRounds = 100) {
+			std::mutex mutex;
+			std::atomic<int> claimed(0);
+			std::atomic<bool> stop(false);
+			int rounds = 0, result = 0, wins = 0, loses = 0;
+			for (size_t t = 0; t < pool.size(); t++) {
+				pool.submit([&] {
+					while (!stop.load(std::memory_order_relaxed) && claimed.fetch_add(1) < n) {
+						auto [score, win, lose] = randomBenchmarkerSingle();
+						std::lock_guard<std::mutex> lock(mutex);
+						rounds++;
+						result += score;
+						wins += win;
+						loses += lose;
+						if (rounds >= minRounds && wilsonMargin(wins, 2 * rounds) < margin)
+							stop.store(true, std::memory_order_relaxed);
+					}
+				});
+			}
+			pool.wait();
+			StrengthEstimate e;
+			e.games = 2 * rounds;
+			if (rounds) {
+				e.score = (double) result / e.games;
+				e.wins = 100.0 * wins / e.games;
+				e.loses = 100.0 * loses / e.games;
+			}
+			e.margin = 100 * wilsonMargin(wins, e.games);
+			return e;
+		}
+
+		// Same as randomBenchmarker against any opponent with predictMove, such as MCTS or AlphaBeta
+		template<typename Opponent>
+		std::tuple<double, double, double> benchmarker(Opponent& opponent, int n = 100) {
+			Derived* self = static_cast<Derived*>(this);
+			int result = 0;
+			int wins = 0;
+			int loses = 0;
+			for (int i = 0; i < 2 * n; i++) {
+				// Alternate colours, c is the colour of this player
+				int c = i % 2 ? -1 : 1;
+				GameState board;
+				while (!board.isFinal()) {
+					int turn = board.getColour();
+					auto [x, y] = turn == c ? self->predictMove(board) : opponent.predictMove(board);
+					board.placePiece(x, y, turn);
+				}
+				int score = c * board.getScore();
+				result += score;
+				wins += score > 0 ? 1 : 0;
+				loses += score < 0 ? 1 : 0;
+			}
+			return {(double) result / ((double)n * 2), (double)wins/((double)n * 2) * 100, (double) loses / ((double) n*2) * 100};
+		}
+
+		~Player() {
+			delete scoreMutex;
+		}
+
+};
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef QLEARNER
+#define QLEARNER
+#include "threadsafeplayer.cpp"
+#include "replaybuffer.cpp"
+#include "randomgenerator.cpp"
+#include <vector>
+#include <string>
+#include <iostream>
+
+
+class QLearner {
+
+	using Workspace = NeuralNetwork<double>::Workspace;
+
+	private:
+
+		ReplayBuffer replay;
+
+		// Batch buffers, allocated once
+		std::vector<size_t> indices;
+		Matrix<double> batchX;
+		Matrix<double> batchY;
+		Workspace workspace;
+
+	public:
+
+		ThreadSafePlayer<>* approximator;
+		double gamma;
+
+		QLearner(ThreadSafePlayer<>* a, double g, size_t capacity = 1 << 20, bool prioritized = false) : replay(capacity, prioritized), approximator(a), gamma(g) {
+			workspace = approximator->workspace(0);
+		}
+
+		// Value for the player who just moved into s, from the best reply of the opponent
+		static double getTarget(ThreadSafePlayer<>* net, const GameState& s, const double gamma) {
+			int mover = -s.getColour();
+			if (s.isFinal())
+				return mover * s.getScore() / MAX_SCORE;
+
+			int c = s.getColour();
+			double m = 0;
+			bool first = true;
+			for (auto [i, j] : s.validMoves(c)) {
+				double p = net->evaluate(c*s.potentialBoard(i, j, c).input())[0];
+				if (first || p > m) {
+					m = p;
+					first = false;
+				}
+			}
+			return -gamma * m;
+		}
+
+		// Plays one epsilon-greedy self-play game, emit(position, target) is called after every move
+		template<typename F>
+		static void playGame(ThreadSafePlayer<>* net, const double epsilon, const double gamma, F emit) {
+			GameState s;
+			while (!s.isFinal()) {
+				int c = s.getColour();
+				if (RandomGenerator::randomDouble(0, 1) < epsilon) {
+					auto moves = s.validMoves(c);
+					auto [i, j] = moves[RandomGenerator::randomInt(0, moves.size() - 1)];
+					s.placePiece(i, j, c);
+				} else {
+					auto [i, j] = net->predictMove(s);
+					s.placePiece(i, j, c);
+				}
+				emit(Bitboard(s, c), getTarget(net, s, gamma));
+			}
+		}
+
+		void playGame(double epsilon) {
+			playGame(approximator, epsilon, gamma, [this] (const Bitboard& b, double target) {
+				replay.add(b, target);
+			});
+		}
+
+		void addSample(const Bitboard& b, const double target) {
+			replay.add(b, target);
+		}
+
+		void trainBatch(size_t batchSize, double eta) {
+			batchSize = std::min(batchSize, replay.size());
+			// Nothing to learn from yet
+			if (batchSize == 0)
+				return;
+			indices.resize(batchSize);
+			replay.sample(indices.data(), batchSize);
+			replay.fill(indices.data(), batchSize, batchX, batchY);
+			approximator->updateBatch(batchX, batchY, eta, workspace);
+			if (replay.prioritized) {
+				// New priorities from the error after the update
+				const Matrix<double>& out = approximator->forward(batchX, workspace);
+				for (size_t i = 0; i < batchSize; i++)
+					replay.updatePriority(indices[i], out[i] - batchY[i]);
+			}
+		}
+
+		// Constant memory: every epoch adds nGames games to the ring buffer and trains updates minibatches
+		void replayTrain(int nGames, int batchSize, double eta, double epsilon, double decay, int updates = 100, int epochs = -1, bool verbose = false, bool test = false, int testRate = 100, int testSize = 5000) {
+
+			for (; epochs != 0; epochs--) {
+
+				for (int k = 0; k < nGames; k++)
+					playGame(epsilon);
+
+				for (int k = 0; k < updates; k++)
+					trainBatch(batchSize, eta);
+
+				if (verbose) {
+					std::cout << "Loop: " << epochs << " Replay size: " << replay.size() << '\n';
+				}
+
+				if (test && epochs%testRate == 0) {
+					auto [score, win, lose] = approximator->randomBenchmarker(testSize);
+					std::cout << "Avg score: " << score << " Percentage won: " << win <<  " Percentage lost: " << lose << " Percentage draw: " << (100 - win - lose) << std::endl;
+				}
+				epsilon *= decay;
+			}
+		}
+
+		inline size_t replaySize() const {
+			return replay.size();
+		}
+
+		void save(const std::string &filename) {
+			approximator->saveNetwork(filename);
+		}
+};
+#endif
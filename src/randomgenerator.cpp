@@ -2,11 +2,15 @@
 #define RANDOMGEN
 
 #include <random>
+#include <thread>
+#include <functional>
+#include <ctime>
 
 class RandomGenerator {
 
 	public:
-		static std::default_random_engine generator;
+		// One engine per thread, seeded differently so threads do not share sequences
+		static thread_local std::default_random_engine generator;
 
 		static double randomDouble(double min, double max) {
 			std::uniform_real_distribution<double> dist(min, max);
@@ -18,6 +22,6 @@ class RandomGenerator {
 		}
 };
 
-std::default_random_engine RandomGenerator::generator = std::default_random_engine(time(0));
+thread_local std::default_random_engine RandomGenerator::generator = std::default_random_engine(time(0) ^ std::hash<std::thread::id>()(std::this_thread::get_id()));
 
 #endif
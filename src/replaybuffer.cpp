@@ -0,0 +1,123 @@
+#ifndef REPLAYBUFFER
+#define REPLAYBUFFER
+#include "endgame.cpp"
+#include "matrix.cpp"
+#include "randomgenerator.cpp"
+#include <vector>
+#include <cmath>
+
+
+// Binary tree of partial sums over the priorities, leaves are the buffer slots
+class SumTree {
+
+	private:
+
+		size_t leaves;
+		std::vector<double> tree;
+
+	public:
+
+		SumTree(size_t capacity = 0) {
+			leaves = 1;
+			while (leaves < capacity)
+				leaves *= 2;
+			tree.assign(2 * leaves, 0);
+		}
+
+		void update(size_t index, const double priority) {
+			index += leaves;
+			double change = priority - tree[index];
+			for (; index; index /= 2)
+				tree[index] += change;
+		}
+
+		inline double get(const size_t index) const {
+			return tree[index + leaves];
+		}
+
+		inline double total() const {
+			return tree[1];
+		}
+
+		// Slot whose cumulative priority range contains value
+		size_t find(double value) const {
+			size_t index = 1;
+			while (index < leaves) {
+				if (value < tree[2 * index] || tree[2 * index + 1] == 0) {
+					index = 2 * index;
+				} else {
+					value -= tree[2 * index];
+					index = 2 * index + 1;
+				}
+			}
+			return index - leaves;
+		}
+};
+
+
+// Fixed-size ring buffer of positions and targets, the oldest sample is overwritten when full
+class ReplayBuffer {
+
+	private:
+
+		std::vector<Bitboard> positions;
+		std::vector<float> targets;
+		SumTree priorities;
+		size_t capacity;
+		size_t head = 0;
+		size_t count = 0;
+		double maxPriority = 1;
+
+	public:
+
+		bool prioritized;
+		// Exponent that flattens priorities, 0 is uniform
+		double alpha = 0.6;
+
+		ReplayBuffer(size_t n, bool p = false) : positions(n), targets(n), priorities(p ? n : 0), capacity(n), prioritized(p) {}
+
+		void add(const Bitboard& position, const double target) {
+			positions[head] = position;
+			targets[head] = target;
+			if (prioritized)
+				priorities.update(head, maxPriority);
+			head = (head + 1) % capacity;
+			count = std::min(count + 1, capacity);
+		}
+
+		inline size_t size() const {
+			return count;
+		}
+
+		void sample(size_t* indices, const size_t n) const {
+			if (!prioritized) {
+				for (size_t i = 0; i < n; i++)
+					indices[i] = RandomGenerator::randomInt(0, count - 1);
+				return;
+			}
+			// Stratified: one sample from each of n equal slices of the total priority
+			double slice = priorities.total() / n;
+			for (size_t i = 0; i < n; i++)
+				indices[i] = std::min(priorities.find(RandomGenerator::randomDouble(i * slice, (i + 1) * slice)), count - 1);
+		}
+
+		void updatePriority(const size_t index, const double error) {
+			if (!prioritized)
+				return;
+			double p = std::pow(std::abs(error) + 1e-3, alpha);
+			maxPriority = std::max(maxPriority, p);
+			priorities.update(index, p);
+		}
+
+		// Decode the sampled positions and targets into preallocated batch matrices
+		void fill(const size_t* indices, const size_t n, Matrix<double>& X, Matrix<double>& Y) const {
+			X.resize(n, BOARD_SIZE);
+			Y.resize(n, 1);
+			for (size_t i = 0; i < n; i++) {
+				positions[indices[i]].decode(X.raw() + i * BOARD_SIZE);
+				Y[i] = targets[indices[i]];
+			}
+		}
+};
+
+#endif
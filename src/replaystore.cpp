@@ -0,0 +1,306 @@
+#ifndef REPLAYSTORE
+#define REPLAYSTORE
+#include "endgame.cpp"
+#include "matrix.cpp"
+#include "boundedqueue.cpp"
+#include "randomgenerator.cpp"
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+// On-disk replay data: a directory of append-only segment files, each a
+// 64 byte header followed by fixed-size records. A record is a position as
+// bitboards from the perspective of the player who just moved, and its target.
+// Segments have no record count, a torn record at the tail is ignored.
+struct ReplayRecord {
+	uint64_t own;
+	uint64_t opp;
+	float target;
+	uint32_t reserved;
+};
+
+namespace ReplayFormat {
+	constexpr char magic[8] = {'F', 'L', 'P', 'R', 'E', 'P', 'L', 'Y'};
+	constexpr uint32_t version = 1;
+	constexpr size_t headerSize = 64;
+
+	inline std::string segmentName(const std::string& directory, const size_t index) {
+		char name[32];
+		snprintf(name, sizeof(name), "/segment-%06zu.rpl", index);
+		return directory + name;
+	}
+}
+
+
+// Appends records from any thread, a background thread batches them into
+// the current segment and starts a new one every segmentRecords records
+class ReplayWriter {
+
+	private:
+
+		std::string directory;
+		size_t segmentRecords;
+		BoundedQueue<ReplayRecord> queue;
+		std::thread writer;
+		std::atomic<bool> stopping;
+		FILE* segment = nullptr;
+		size_t segmentIndex = 0;
+		size_t inSegment = 0;
+
+		void openSegment() {
+			if (segment)
+				fclose(segment);
+			segment = nullptr;
+			std::string name = ReplayFormat::segmentName(directory, segmentIndex++);
+			segment = fopen(name.c_str(), "wb");
+			if (!segment) {
+				std::cerr << "Could not create " << name << std::endl;
+				throw "Could not create replay segment";
+			}
+			char header[ReplayFormat::headerSize] = {};
+			uint32_t recordSize = sizeof(ReplayRecord);
+			memcpy(header, ReplayFormat::magic, sizeof(ReplayFormat::magic));
+			memcpy(header + 8, &ReplayFormat::version, 4);
+			memcpy(header + 12, &recordSize, 4);
+			fwrite(header, 1, sizeof(header), segment);
+			inSegment = 0;
+		}
+
+		void write(const ReplayRecord* records, size_t n) {
+			while (n > 0) {
+				if (!segment || inSegment == segmentRecords)
+					openSegment();
+				size_t k = std::min(n, segmentRecords - inSegment);
+				if (fwrite(records, sizeof(ReplayRecord), k, segment) != k)
+					throw "Could not write replay segment";
+				inSegment += k;
+				records += k;
+				n -= k;
+				written.fetch_add(k, std::memory_order_release);
+			}
+		}
+
+		void work() {
+			std::vector<ReplayRecord> batch;
+			batch.reserve(writeBatch);
+			while (true) {
+				bool stop = stopping.load(std::memory_order_acquire);
+				ReplayRecord r;
+				while (batch.size() < writeBatch && queue.pop(r))
+					batch.push_back(r);
+				if (!batch.empty()) {
+					size_t before = written.load(std::memory_order_relaxed);
+					try {
+						write(batch.data(), batch.size());
+					} catch (const char* e) {
+						// The rest of the batch is lost, the next batch tries a new segment
+						std::cerr << e << std::endl;
+						failed.fetch_add(batch.size() - (written.load(std::memory_order_relaxed) - before), std::memory_order_relaxed);
+						if (segment)
+							fclose(segment);
+						segment = nullptr;
+					}
+					batch.clear();
+					// Readers only see whole records that reached the file
+					if (segment && queue.size() == 0)
+						fflush(segment);
+				} else if (stop) {
+					break;
+				} else {
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+			}
+			if (segment)
+				fflush(segment);
+		}
+
+	public:
+
+		constexpr static size_t writeBatch = 1 << 12;
+
+		std::atomic<size_t> written;
+		// Records that had to wait for the writer
+		std::atomic<size_t> stalls;
+		// Records dropped because a segment could not be created or written
+		std::atomic<size_t> failed;
+
+		// Segments continue after any that are already in the directory
+		ReplayWriter(const std::string& dir, size_t recordsPerSegment = 1 << 22, size_t queueSize = 1 << 16) : directory(dir), segmentRecords(recordsPerSegment), queue(queueSize), stopping(false), written(0), stalls(0), failed(0) {
+			std::filesystem::create_directories(directory);
+			while (std::filesystem::exists(ReplayFormat::segmentName(directory, segmentIndex)))
+				segmentIndex++;
+			openSegment();
+			writer = std::thread(&ReplayWriter::work, this);
+		}
+
+		void add(const Bitboard& b, const double target) {
+			ReplayRecord r = {b.own, b.opp, (float) target, 0};
+			while (!queue.push(r)) {
+				stalls.fetch_add(1, std::memory_order_relaxed);
+				std::this_thread::yield();
+			}
+		}
+
+		// Position after player c moved
+		void add(const GameState& s, const int c, const double target) {
+			add(Bitboard(s, c), target);
+		}
+
+		// Write everything that is queued and stop the writer
+		void close() {
+			if (!writer.joinable())
+				return;
+			stopping.store(true, std::memory_order_release);
+			writer.join();
+			if (segment)
+				fclose(segment);
+			segment = nullptr;
+		}
+
+		~ReplayWriter() {
+			close();
+		}
+};
+
+
+// Read side of a replay directory. Segments are mapped read-only and sampled
+// uniformly, the pages of the next minibatch can be requested ahead of time.
+class ReplayStore {
+
+	private:
+
+		struct Segment {
+			std::string name;
+			const char* data = nullptr;
+			size_t bytes = 0;
+			size_t records = 0;
+		};
+
+		std::string directory;
+		std::vector<Segment> segments;
+		// First global record index of every segment, plus the total at the end
+		std::vector<size_t> offsets = {0};
+		size_t pageSize;
+
+		void map(Segment& segment) {
+			int fd = open(segment.name.c_str(), O_RDONLY);
+			if (fd < 0) {
+				std::cerr << "Could not open " << segment.name << std::endl;
+				throw "Could not open replay segment";
+			}
+			struct stat st;
+			fstat(fd, &st);
+			if ((size_t) st.st_size < ReplayFormat::headerSize) {
+				close(fd);
+				return;
+			}
+			void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+			close(fd);
+			if (data == MAP_FAILED)
+				throw "Could not map replay segment";
+
+			const char* header = (const char*) data;
+			uint32_t recordSize;
+			memcpy(&recordSize, header + 12, 4);
+			if (memcmp(header, ReplayFormat::magic, sizeof(ReplayFormat::magic)) != 0 || recordSize != sizeof(ReplayRecord)) {
+				munmap(data, st.st_size);
+				std::cerr << segment.name << " is not a replay segment" << std::endl;
+				throw "Invalid replay segment";
+			}
+			madvise(data, st.st_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
+			segment.data = header;
+			segment.bytes = st.st_size;
+			segment.records = (st.st_size - ReplayFormat::headerSize) / sizeof(ReplayRecord);
+		}
+
+		void unmap(Segment& segment) {
+			if (segment.data)
+				munmap((void*) segment.data, segment.bytes);
+			segment.data = nullptr;
+			segment.bytes = segment.records = 0;
+		}
+
+	public:
+
+		// Access pattern hint for the kernel: random disables readahead for sampling,
+		// sequential reads ahead aggressively for full passes
+		bool sequential;
+
+		ReplayStore(const std::string& dir, bool seq = false) : directory(dir), pageSize(sysconf(_SC_PAGESIZE)), sequential(seq) {
+			refresh();
+		}
+
+		ReplayStore(const ReplayStore&) = delete;
+		ReplayStore& operator=(const ReplayStore&) = delete;
+
+		// Pick up new segments and records appended since the last call
+		void refresh() {
+			while (std::filesystem::exists(ReplayFormat::segmentName(directory, segments.size())))
+				segments.push_back({ReplayFormat::segmentName(directory, segments.size())});
+			offsets.assign(1, 0);
+			for (auto& segment : segments) {
+				struct stat st;
+				if (stat(segment.name.c_str(), &st) == 0 && (size_t) st.st_size != segment.bytes) {
+					unmap(segment);
+					map(segment);
+				}
+				offsets.push_back(offsets.back() + segment.records);
+			}
+		}
+
+		inline size_t size() const {
+			return offsets.back();
+		}
+
+		const ReplayRecord& operator[](const size_t index) const {
+			size_t s = std::upper_bound(offsets.begin(), offsets.end(), index) - offsets.begin() - 1;
+			const char* records = segments[s].data + ReplayFormat::headerSize;
+			return ((const ReplayRecord*) records)[index - offsets[s]];
+		}
+
+		void sample(size_t* indices, const size_t n) const {
+			if (size() == 0)
+				throw "Cannot sample an empty replay store";
+			for (size_t i = 0; i < n; i++)
+				indices[i] = RandomGenerator::randomInt(0, size() - 1);
+		}
+
+		// Ask the kernel to start reading the pages of these records, call it
+		// for the next minibatch while the current one is trained on
+		void willNeed(const size_t* indices, const size_t n) const {
+			for (size_t i = 0; i < n; i++) {
+				uintptr_t page = (uintptr_t) &(*this)[indices[i]] & ~(uintptr_t) (pageSize - 1);
+				madvise((void*) page, pageSize, MADV_WILLNEED);
+			}
+		}
+
+		// Decode records into preallocated batch matrices, same layout as ReplayBuffer::fill
+		void fill(const size_t* indices, const size_t n, Matrix<double>& X, Matrix<double>& Y) const {
+			X.resize(n, BOARD_SIZE);
+			Y.resize(n, 1);
+			for (size_t i = 0; i < n; i++) {
+				const ReplayRecord& r = (*this)[indices[i]];
+				Bitboard(r.own, r.opp).decode(X.raw() + i * BOARD_SIZE);
+				Y[i] = r.target;
+			}
+		}
+
+		~ReplayStore() {
+			for (auto& segment : segments)
+				unmap(segment);
+		}
+};
+
+#endif
@@ -3,85 +3,258 @@
 #include <thread>
 #include <vector>
 #include "threadsafeplayer.cpp"
+#include "ntupleplayer.cpp"
 #include "activators.cpp"
+#include "gamelog.cpp"
+#include "checkpoint.cpp"
+#include "affinity.cpp"
+#include "arena.cpp"
+#include "metrics.cpp"
+#include "instrument.cpp"
+#include "trace.cpp"
+#include "allocations.cpp"
 #include <iostream>
 #include <random>
+#include <chrono>
+#include <cmath>
 
 
+// P is the player type, it needs eval, predictMove, the score methods, a Scalar type and weights/biases to evolve
+template<typename P = ThreadSafePlayer<>>
 class Supervisor {
 private:
 
 	int size;
 	const double exchangeChance = 0.5;
 	int threads = 4; //0 for thread concurruncy
+	// Optional record of every competition game, see logGames
+	GameLog *gameLog = nullptr;
+	// Two per worker, select() fills one while the previous generation still lives in the other
+	std::vector<Arena*> arenas;
+	int arenaParity = 0;
+	// Strength tests run here, created with the first one
+	ThreadPool *benchmarkPool = nullptr;
+	// Background strength test of a copy of the best player
+	std::thread benchmarkThread;
+	std::mutex strengthMutex;
+	StrengthEstimate strength;
+
+	void report(const StrengthEstimate &e, int g) {
+		std::lock_guard<std::mutex> lock(strengthMutex);
+		strength = e;
+		std::cout << "Generation " << g << " Score: " << e.score << " Wins: " << e.wins << " Loses: " << e.loses << " Draws: " << (100 - e.loses - e.wins)
+			<< " Games: " << e.games << " (+-" << e.margin << "%)" << std::endl;
+	}
+
+	int workers() const {
+		return threads ? threads : std::thread::hardware_concurrency();
+	}
+
+	// Consecutive workers go to different NUMA nodes
+	static int workerCpu(int w) {
+		int nodes = Affinity::numaNodes();
+		std::vector<int> cpus = Affinity::nodeCpus(w % nodes);
+		return cpus[(w / nodes) % cpus.size()];
+	}
+
+	// Worker whose arena holds player i, players from before the first select() are split in blocks
+	int home(int i) {
+		if (!players[i]->weights.empty())
+			for (unsigned int k = 0; k < arenas.size(); k++)
+				if (arenas[k]->contains(players[i]->weights[0].raw()))
+					return k / 2;
+		return (long) i * workers() / size;
+	}
+
+	// Every worker copies its block of the new population into its own arena, from its own CPU
+	void cloneLocal(const std::vector<int> &parents, std::vector<P*> &newPlayers) {
+		int n = workers();
+		if (arenas.size() < 2 * (size_t) n) {
+			size_t bytes = 0;
+			for (auto& m : players[0]->weights)
+				bytes += m.size() * sizeof(m[0]) + 64;
+			for (auto& m : players[0]->biases)
+				bytes += m.size() * sizeof(m[0]) + 64;
+			// Room for whatever else a player allocates, the rest goes to the heap
+			bytes = 2 * bytes * ((size + n - 1) / n) + 4096;
+			while (arenas.size() < 2 * (size_t) n)
+				arenas.push_back(new Arena(bytes, hugepages));
+		}
+		// The other arena of each worker holds the players that are replaced now
+		arenaParity ^= 1;
+		std::vector<std::thread> cloners;
+		for (int w = 0; w < n; w++) {
+			cloners.emplace_back([&, w] {
+				Affinity::pinThread(workerCpu(w));
+				Trace::nameThread("cloner " + std::to_string(w));
+				Trace::Span span("clone", "worker", w);
+				Arena* arena = arenas[2 * w + arenaParity];
+				arena->reset();
+				Arena::Scope scope(arena);
+				for (int i = (long) w * size / n; i < (long) (w + 1) * size / n; i++)
+					newPlayers[i] = new P(*players[parents[i]]);
+			});
+		}
+		for (auto& t : cloners)
+			t.join();
+	}
 
 public:
 
-    std::vector<ThreadSafePlayer*> players;
-    Supervisor(int n, std::vector<size_t> sizes, const Function<double>* av, const Function<double>* f) {
+    std::vector<P*> players;
+    int generation = 0;
+    // Population checkpoint every checkpointRate generations, 0 disables it
+    int checkpointRate = 0;
+    std::string checkpointFile;
+    CheckpointWriter *checkpointWriter = nullptr;
+    // Pin workers to CPUs spread over the NUMA nodes, each keeps its block of the population on its node
+    bool pinWorkers = false;
+    // Back those blocks with transparent huge pages
+    bool hugepages = false;
+    // Timing and throughput of the last generation, also written to metricsLogger if set
+    GenerationMetrics metrics;
+    MetricsLogger *metricsLogger = nullptr;
+    // Trace files are written after every generation when set
+    std::string tracePrefix;
+    // Strength tests stop once the 95% interval of the win rate is within plus or minus this
+    double benchmarkMargin = 0.02;
+    // Test a copy of the best player in the background, overlapped with the next generations
+    bool backgroundBenchmark = false;
+
+    // Sizes ending in BOARD_SIZE give policy-head players, sizes ending in 1 value players
+    Supervisor(int n, std::vector<size_t> sizes, const Function<typename P::Scalar>* av, const Function<typename P::Scalar>* f) {
 		size = n;
         for (int i = 0; i < n; i++) {
-            players.push_back(new ThreadSafePlayer(sizes, av, f));
+            players.push_back(new P(sizes, av, f));
         }
     }
 
-	void evolve(int i = -1, double mutationChance = 0.001, double crossoverChance = 0.1, bool verbose = true, bool test = true, int frequency = 50, int testSize = 5000) {
+    // Players without layer sizes, such as the NTuplePlayer, start from their default constructor
+    Supervisor(int n) {
+		size = n;
+        for (int i = 0; i < n; i++) {
+            players.push_back(new P());
+        }
+    }
 
-		int start = i;
+	void evolve(int i = -1, double mutationChance = 0.001, double crossoverChance = 0.1, bool verbose = true, bool test = true, int frequency = 50, int testSize = 5000) {
 
 		while (i != 0) {
 
-			playCompetition();
+			auto begin = std::chrono::steady_clock::now();
+			Allocations::Counts heap = Allocations::all();
+			// Runs a phase inside a trace span, returns its wall time
+			auto phase = [this](const char* name, auto f) {
+				auto start = std::chrono::steady_clock::now();
+				Trace::Span span(name, "generation", generation);
+				f();
+				return Metrics::seconds(start);
+			};
 
-			if (test && !(i % frequency)) {
-				benchmarkBestRandom(testSize);
-			}
+			metrics.competition = phase("competition", [&] { playCompetition(); });
+
+			metrics.benchmark = 0;
+			if (test && !(i % frequency))
+				metrics.benchmark = phase("benchmark", [&] { benchmarkBestRandom(testSize); });
 
-			select();
-			crossover(crossoverChance);
-			mutate(mutationChance);
+			metrics.selection = phase("select", [&] { select(); });
+			metrics.crossover = phase("crossover", [&] { crossover(crossoverChance); });
+			metrics.mutation = phase("mutate", [&] { mutate(mutationChance); });
 			i--;
+			generation++;
 
-			if (verbose) {
-				std::cout << "Episode " << start - i << std::endl;
-			}
+			if (checkpointRate && generation % checkpointRate == 0)
+				checkpoint();
+
+			if (!tracePrefix.empty())
+				Trace::dump(tracePrefix + "-" + std::to_string(generation) + ".json");
+
+			metrics.generation = generation;
+			metrics.total = Metrics::seconds(begin);
+			Allocations::Counts used = Allocations::all() - heap;
+			metrics.allocations = used.allocations;
+			metrics.allocatedBytes = used.bytes;
+			if (metricsLogger)
+				metricsLogger->log(metrics);
+			if (verbose)
+				std::cout << metrics.summary() << '\n';
 		}
 	}
 
+	// One Chrome trace file per generation, prefix-<generation>.json
+	void traceTo(const std::string &prefix) {
+		tracePrefix = prefix;
+		Trace::enable();
+	}
+
+	// Competition workers, 0 for one per hardware thread
+	void setThreads(int n) {
+		threads = n;
+	}
+
+	// JSON lines, or CSV if the file name ends in .csv
+	void logMetrics(const std::string &filename) {
+		delete metricsLogger;
+		metricsLogger = new MetricsLogger(filename);
+	}
+
+
+	void checkpointEvery(int generations, const std::string &filename) {
+		checkpointRate = generations;
+		checkpointFile = filename;
+		if (!checkpointWriter)
+			checkpointWriter = new CheckpointWriter();
+	}
+
+	// Snapshot on this thread, the file is written in the background
+	void checkpoint() {
+		if (!checkpointWriter)
+			checkpointWriter = new CheckpointWriter();
+		checkpointWriter->submit(Checkpoint::snapshot(players, generation), checkpointFile);
+	}
+
+	// The population has to have the same size and layer sizes as the checkpoint
+	bool resume(const std::string &filename) {
+		std::ifstream exists(filename);
+		if (!exists)
+			return false;
+		generation = Checkpoint::read(filename).restore(players);
+		return true;
+	}
 
 	void crossover(double alpha) {
-		std::random_shuffle(players.begin(), players.end());
+		// Shuffled with the checkpointed generator, so a resumed run continues the same sequence
+		std::shuffle(players.begin(), players.end(), RandomGenerator::generator);
 		int half = size/2;
 		for (int i = 0; i < half; i++)
 			if (RandomGenerator::randomDouble(0, 1) > alpha)
 				randomSelect(*players[i], *players[half + i]);
 	}
 
-	void cut(ThreadSafePlayer& p1, ThreadSafePlayer& p2) {
+	void cut(P& p1, P& p2) {
 		//todo implement single cut and switch
 	}
 
-	void randomSelect(ThreadSafePlayer& p1, ThreadSafePlayer& p2) {
+	void randomSelect(P& p1, P& p2) {
 		for (unsigned int i = 0; i < p1.weights.size(); i++) {
 			for (unsigned int j = 0; j < p1.weights[i].rows*p1.weights[i].columns; j++) {
 				if (RandomGenerator::randomDouble(0, 1) > exchangeChance) {
-					double temp = p1.weights[i][j];
-					p1.weights[i][j] = p2.weights[i][j];
-					p2.weights[i][j] = temp;
+					std::swap(p1.weights[i][j], p2.weights[i][j]);
 				}
 			}
+		}
 
+		// Biases are looped separately, an n-tuple player has more tables than biases
+		for (unsigned int i = 0; i < p1.biases.size(); i++) {
 			for (unsigned int j = 0; j < p1.biases[i].rows*p1.biases[i].columns; j++) {
 				if (RandomGenerator::randomDouble(0, 1) > exchangeChance) {
-					double temp = p1.biases[i][j];
-					p1.biases[i][j] = p2.biases[i][j];
-					p2.biases[i][j] = temp;
+					std::swap(p1.biases[i][j], p2.biases[i][j]);
 				}
 			}
 		}
 	}
 
-	void biologicalCut(ThreadSafePlayer& p1, ThreadSafePlayer& p2) {
+	void biologicalCut(P& p1, P& p2) {
 		//todo implement biological cut and switch
 	}
 
@@ -100,10 +273,17 @@ public:
 		for (int i = 1; i < size; i++) {
 			arr[i] = arr[i - 1] + players[i]->getScore()/totalScore;
 		}
-		std::vector<ThreadSafePlayer*> newPlayers;
+		std::vector<int> parents;
 		for (int i = 0; i < size; i++) {
 			auto index = std::lower_bound(arr, arr + size, RandomGenerator::randomDouble(0, 1)) - arr - 1;
-			newPlayers.push_back(new ThreadSafePlayer(*players[index]));
+			parents.push_back(index);
+		}
+		std::vector<P*> newPlayers(size);
+		if (pinWorkers) {
+			cloneLocal(parents, newPlayers);
+		} else {
+			for (int i = 0; i < size; i++)
+				newPlayers[i] = new P(*players[parents[i]]);
 		}
 
 		for (int i = 0; i < size; i++) {
@@ -120,14 +300,15 @@ public:
 
 	void defaultMutate(int p, double mutationChance) {
 		double mutation_amount = 0.1;
-		for (unsigned int i = 0; i < players[p]->weights.size(); i++) {
-			
+		for (unsigned int i = 0; i < players[p]->biases.size(); i++) {
 			for (unsigned int j = 0; j < players[p]->biases[i].size(); j++) {
 				if (RandomGenerator::randomDouble(0,1) < mutationChance) {
 					players[p]->biases[i][j] += RandomGenerator::randomDouble(-mutation_amount, mutation_amount);
 				}
 			}
+		}
 
+		for (unsigned int i = 0; i < players[p]->weights.size(); i++) {
 			for (unsigned int j = 0; j < players[p]->weights[i].size(); j++) {
 				if (RandomGenerator::randomDouble(0,1) < mutationChance) {
 					players[p]->weights[i][j] += RandomGenerator::randomDouble(-mutation_amount, mutation_amount);
@@ -136,64 +317,181 @@ public:
 		}
 	}
 
-	static void _worker(std::vector<std::tuple<ThreadSafePlayer*, ThreadSafePlayer*>> *pairs, std::mutex *index_mutex, unsigned int *index) {
+	void logGames(const std::string &filename) {
+		delete gameLog;
+		gameLog = new GameLog(filename, threads ? threads : std::thread::hardware_concurrency());
+	}
+
+	// Writes the remaining games and the index, the file can be read afterwards
+	void stopLogging() {
+		delete gameLog;
+		gameLog = nullptr;
+	}
+
+	// ranges holds the next and the end index of every block of pairs, a worker starts
+	// with its own block and then helps with the others
+	static void _worker(std::vector<std::tuple<int, int>> *pairs, std::vector<P*> *players, std::mutex *index_mutex, std::vector<std::pair<unsigned int, unsigned int>> *ranges, GameLog *log, int slot, int cpu, WorkerMetrics *stats) {
+        if (cpu >= 0)
+            Affinity::pinThread(cpu);
+        Trace::nameThread("worker " + std::to_string(slot));
+        GameRecord record;
+        size_t own = slot % ranges->size();
         while (true) {
             index_mutex->lock();
-            unsigned int next_index = *index;
-            if (next_index >= pairs->size()) {
+            size_t k = 0;
+            while (k < ranges->size() && (*ranges)[(own + k) % ranges->size()].first >= (*ranges)[(own + k) % ranges->size()].second)
+                k++;
+            if (k == ranges->size()) {
                 index_mutex->unlock();
                 break;
             }
-            *index += 1;
+            unsigned int next_index = (*ranges)[(own + k) % ranges->size()].first++;
             index_mutex->unlock();
-            auto [p1, p2] = (*pairs)[next_index];
-            double score = ThreadSafePlayer::eval(p1, p2);
+            if (k) {
+                INSTRUMENT_COUNT(steals);
+                Trace::instant("steal", "block", (own + k) % ranges->size());
+            }
+            auto [i, j] = (*pairs)[next_index];
+            P *p1 = (*players)[i], *p2 = (*players)[j];
+            auto start = std::chrono::steady_clock::now();
+            unsigned long evaluations = Metrics::evaluations;
+            Allocations::Scope heap;
+            double score;
+            {
+                INSTRUMENT_SCOPE(game);
+                INSTRUMENT_COUNT(games);
+                Trace::Span span("game", "white", i);
+                score = P::eval(p1, p2, log ? record.moves : nullptr);
+            }
+            stats->busy += Metrics::seconds(start);
+            stats->evaluations += Metrics::evaluations - evaluations;
+            stats->allocations += heap.counts().allocations;
+            stats->positions += BOARD_SIZE - 4;
+            stats->games++;
+            if (log) {
+                record.white = i;
+                record.black = j;
+                record.score = score;
+                log->record(slot, record);
+            }
             p1->addScore(32 + score/2);
             p2->addScore(32 - score/2);
         }
     }
 
     void playCompetition() {
-        // Pair players
-        std::vector<std::tuple<ThreadSafePlayer*, ThreadSafePlayer*>> pairs;
-        for (auto i : players) {
-            for (auto j : players) {
-                if (i != j) {
-                    pairs.push_back(std::make_tuple(i, j));
+        int n = workers();
+        // Pair players, grouped by the worker that holds the first player when pinned
+        std::vector<int> homes(size, 0);
+        if (pinWorkers)
+            for (int i = 0; i < size; i++)
+                homes[i] = home(i);
+        std::vector<std::tuple<int, int>> pairs;
+        std::vector<std::pair<unsigned int, unsigned int>> ranges;
+        for (int w = 0; w < (pinWorkers ? n : 1); w++) {
+            unsigned int begin = pairs.size();
+            for (int i = 0; i < size; i++) {
+                for (int j = 0; j < size; j++) {
+                    if (i != j && homes[i] == w) {
+                        pairs.push_back(std::make_tuple(i, j));
+                    }
                 }
             }
+            ranges.push_back(std::make_pair(begin, (unsigned int) pairs.size()));
+        }
+        if (gameLog) {
+            // setThreads may have added workers since logGames
+            gameLog->growSlots(n);
+            gameLog->nextGeneration(generation);
         }
         // Play competition
-        unsigned int current_index = 0;
         auto m = new std::mutex();
         std::vector<std::thread*> thread_vector;
-        int n = threads ? threads : std::thread::hardware_concurrency();
+        std::vector<WorkerMetrics> stats(n);
+        auto start = std::chrono::steady_clock::now();
         for (int i = 0; i < n; i++) {
-            thread_vector.push_back(new std::thread(_worker, &pairs, m, &current_index));
+            thread_vector.push_back(new std::thread(_worker, &pairs, &players, m, &ranges, gameLog, i, pinWorkers ? workerCpu(i) : -1, &stats[i]));
         }
         for (auto i : thread_vector) {
             i->join();
             delete i;
         }
         delete m;
+        double seconds = Metrics::seconds(start);
+
+        metrics.threads = n;
+        metrics.players = size;
+        metrics.games = metrics.evaluations = metrics.positions = metrics.gameAllocations = 0;
+        double busy = 0;
+        for (auto& s : stats) {
+            metrics.games += s.games;
+            metrics.gameAllocations += s.allocations;
+            metrics.evaluations += s.evaluations;
+            metrics.positions += s.positions;
+            busy += s.busy;
+        }
+        metrics.utilization = seconds > 0 ? busy / (n * seconds) : 0;
+        double total = 0, squares = 0;
+        metrics.best = size ? players[0]->getScore() : 0;
+        for (auto p : players) {
+            total += p->getScore();
+            squares += p->getScore() * p->getScore();
+            metrics.best = std::max(metrics.best, p->getScore());
+        }
+        metrics.mean = size ? total / size : 0;
+        metrics.stddev = size ? std::sqrt(std::max(0.0, squares / size - metrics.mean * metrics.mean)) : 0;
     }
 
     void sortPlayersByScore() {
-        std::sort(players.begin(), players.end(), [] (ThreadSafePlayer *a, ThreadSafePlayer *b) {
+        std::sort(players.begin(), players.end(), [] (P *a, P *b) {
             return a->getScore() > b->getScore();
         });
     }
 
+    // At most n rounds against random play, fewer once the win rate is known to benchmarkMargin
     void benchmarkBestRandom(int n = 1000) {
         sortPlayersByScore();
-        auto [score, wins, loses] = players[0]->randomBenchmarker(n);
-        std::cout << "Score: " << score << " Wins: " << wins << " Loses: " << loses << " Draws: " << (100 - loses - wins) << std::endl;
+        if (!benchmarkPool)
+            benchmarkPool = new ThreadPool(workers());
+        // One test at a time, they share the pool
+        if (benchmarkThread.joinable())
+            benchmarkThread.join();
+        if (!backgroundBenchmark) {
+            report(players[0]->randomBenchmarker(*benchmarkPool, n, benchmarkMargin), generation);
+            return;
+        }
+        P* best = new P(*players[0]);
+        benchmarkThread = std::thread([this, best, n, g = generation] {
+            StrengthEstimate e = best->randomBenchmarker(*benchmarkPool, n, benchmarkMargin);
+            delete best;
+            report(e, g);
+        });
+    }
+
+    // Last finished strength test
+    StrengthEstimate lastStrength() {
+        std::lock_guard<std::mutex> lock(strengthMutex);
+        return strength;
+    }
+
+    // Waits for a strength test running in the background
+    void waitForBenchmark() {
+        if (benchmarkThread.joinable())
+            benchmarkThread.join();
     }
 
     ~Supervisor() {
+        waitForBenchmark();
+        delete benchmarkPool;
+        delete gameLog;
+        delete metricsLogger;
+        // Finishes a checkpoint that is still being written
+        delete checkpointWriter;
         for (unsigned int i = 0; i < players.size(); i++) {
             delete players[i];
         }
+        for (auto a : arenas)
+            delete a;
     }
 };
 
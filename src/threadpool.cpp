@@ -0,0 +1,98 @@
+#ifndef THREADPOOL
+#define THREADPOOL
+#include <thread>
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <algorithm>
+
+
+class ThreadPool {
+
+	private:
+
+		std::vector<std::thread> workers;
+		std::queue<std::function<void()>> tasks;
+		std::mutex queueMutex;
+		std::condition_variable available;
+		std::condition_variable finished;
+		unsigned int running = 0;
+		bool stopping = false;
+
+		void work() {
+			while (true) {
+				std::function<void()> task;
+				{
+					std::unique_lock<std::mutex> lock(queueMutex);
+					available.wait(lock, [this] { return stopping || !tasks.empty(); });
+					if (stopping && tasks.empty())
+						return;
+					task = std::move(tasks.front());
+					tasks.pop();
+					running++;
+				}
+				task();
+				{
+					std::lock_guard<std::mutex> lock(queueMutex);
+					running--;
+					if (tasks.empty() && !running)
+						finished.notify_all();
+				}
+			}
+		}
+
+	public:
+
+		ThreadPool(int n = 0) { //0 for thread concurrency
+			if (n <= 0)
+				n = std::max(1u, std::thread::hardware_concurrency());
+			for (int i = 0; i < n; i++)
+				workers.emplace_back(&ThreadPool::work, this);
+		}
+
+		inline size_t size() const {
+			return workers.size();
+		}
+
+		void submit(std::function<void()> task) {
+			{
+				std::lock_guard<std::mutex> lock(queueMutex);
+				tasks.push(std::move(task));
+			}
+			available.notify_one();
+		}
+
+		// Block until every submitted task has finished
+		void wait() {
+			std::unique_lock<std::mutex> lock(queueMutex);
+			finished.wait(lock, [this] { return tasks.empty() && !running; });
+		}
+
+		// Run body(i) for i in [0, n), indices are handed out dynamically
+		void parallelFor(size_t n, const std::function<void(size_t)>& body) {
+			std::atomic<size_t> next(0);
+			size_t chunks = std::min(n, size());
+			for (size_t t = 0; t < chunks; t++) {
+				submit([&next, &body, n] {
+					for (size_t i = next++; i < n; i = next++)
+						body(i);
+				});
+			}
+			wait();
+		}
+
+		~ThreadPool() {
+			{
+				std::lock_guard<std::mutex> lock(queueMutex);
+				stopping = true;
+			}
+			available.notify_all();
+			for (auto &w : workers)
+				w.join();
+		}
+};
+
+#endif
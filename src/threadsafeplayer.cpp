@@ -8,77 +8,58 @@
 #include "matrix.cpp"
 #include "neural-network.cpp"
 #include <iostream>
-#include <mutex>
-#include "randomgenerator.cpp"
+#include "player.cpp"
 
 
-class ThreadSafePlayer : public NeuralNetwork<double>{
+// T is the scalar type of the network, float halves the population and doubles the SIMD width
+template<typename T = double>
+class ThreadSafePlayer : public NeuralNetwork<T>, public Player<ThreadSafePlayer<T>> {
 
 	private:
 
-		using VectorMatrix = std::vector<Matrix<double>>;
+		using VectorMatrix = std::vector<Matrix<T>>;
 		using VectorGameState = std::vector<GameState>;
 
-		std::mutex *scoreMutex;
-		double score = 0;
-
 	public:
 
-		ThreadSafePlayer(std::vector<size_t> sizes, const Function<double>* av, const Function<double>* f) : NeuralNetwork(sizes, av, f) {
-			scoreMutex = new std::mutex();
-		}
+		using NeuralNetwork<T>::evaluate;
+		using NeuralNetwork<T>::getOutputSize;
+		using Player<ThreadSafePlayer<T>>::inEndgame;
+		using Player<ThreadSafePlayer<T>>::endgameMove;
 
-		ThreadSafePlayer(const ThreadSafePlayer &old) : NeuralNetwork<double>(old){
-			score = old.score;
-			scoreMutex = new std::mutex();
-		}
+		ThreadSafePlayer(std::vector<size_t> sizes, const Function<T>* av, const Function<T>* f) : NeuralNetwork<T>(sizes, av, f) {}
 
-		void addScore(double change) {
-			scoreMutex->lock();
-			score += change;
-			scoreMutex->unlock();
-		}
+		ThreadSafePlayer(const std::string &filename) : NeuralNetwork<T>(filename) {}
 
-		void setScore(double nScore) {
-			scoreMutex->lock();
-			score = nScore;
-			scoreMutex->unlock();
-		}
+		ThreadSafePlayer(const ThreadSafePlayer &old) : NeuralNetwork<T>(old), Player<ThreadSafePlayer<T>>(old) {}
 
-		double getScore() {
-			return score;
+		inline bool isPolicy() const {
+			// A policy network scores every square of the current board at once
+			return getOutputSize() == BOARD_SIZE;
 		}
 
+		std::tuple<int, int> predictMove(const GameState& s) {
 
-		static double eval(ThreadSafePlayer* p1, ThreadSafePlayer* p2) {
-
-			GameState board;
-
-			for (int k = 0; k < BOARD_SIZE/2 - 2; k++) {
-
-				auto [x1, y1] = p1->predictMove(board);
-				board.placePiece(x1, y1, 1);
-
-				auto [x2, y2] = p2->predictMove(board);
-				board.placePiece(x2, y2, -1);
+			INSTRUMENT_SCOPE(predictMove);
 
+			if (inEndgame(s)) {
+				INSTRUMENT_COUNT(endgameMoves);
+				return endgameMove(s);
 			}
-			return board.getScore();
-
-		}
 
-		std::tuple<int, int> predictMove(const GameState& s) {
+			if (isPolicy())
+				return predictPolicyMove(s);
 
 			int c = s.getColour();
 			auto moves = s.validMoves(c);
 			auto [p, q] = moves[0];
-			double m = evaluate(c*s.potentialBoard(p, q, c).input())[0]; 
+			double m = evaluate(c*s.potentialBoard(p, q, c).input<T>())[0];
 			int r = 0;
 
 			for (unsigned int i = 1; i < moves.size(); i++) {
 
 				auto [x, y] = moves[i];
-				double p = evaluate(c*s.potentialBoard(x, y, c).input())[0];
+				double p = evaluate(c*s.potentialBoard(x, y, c).input<T>())[0];
 
 				if (p > m) {
 					m = p;
@@ -89,56 +70,28 @@ class ThreadSafePlayer : public NeuralNetwork<double>{
 			return moves[r];
 		}
 
-		std::tuple<int, int, int> randomBenchmarkerSingle() {
-
-			GameState white;
-			GameState black;
+		std::tuple<int, int> predictPolicyMove(const GameState& s) {
 
-			for (int k= 0; k < BOARD_SIZE/2-2; k++) {
-
-				// White AI
-				auto [x1, y1] = predictMove(white);
-				white.placePiece(x1, y1, 1);
+			// One forward pass, illegal moves are masked by only looking at valid ones
+			int c = s.getColour();
+			auto moves = s.validMoves(c);
+			Matrix<T> logits = evaluate(c*s.input<T>());
+			auto [p, q] = moves[0];
+			double m = logits[GameState::squareIndex(p, q)];
+			int r = 0;
 
-				// White Random
-				std::vector<std::tuple<int, int>> moves1 = white.validMoves(-1);
-				std::uniform_int_distribution<int> distribution1(0, moves1.size()-1);
-				auto [i1, j1] = moves1[distribution1(RandomGenerator::generator)];
-				white.placePiece(i1, j1, -1);
+			for (unsigned int i = 1; i < moves.size(); i++) {
 
-				// Black Random
-				std::vector<std::tuple<int, int>> moves2 = black.validMoves(1);
-				std::uniform_int_distribution<int> distribution2(0, moves2.size()-1);
-				auto [i2, j2] = moves2[distribution2(RandomGenerator::generator)];
-				black.placePiece(i2, j2, 1);
+				auto [x, y] = moves[i];
+				double p = logits[GameState::squareIndex(x, y)];
 
-				// Black AI
-				auto [x2, y2] = predictMove(black);
-				black.placePiece(x2, y2, -1);
+				if (p > m) {
+					m = p;
+					r = i;
+				}
 			}
 
-			int whiteScore = white.getScore();
-			int blackScore = black.getScore() * -1;
-			int wins = (whiteScore > 0 ? 1 : 0) + (blackScore > 0 ? 1 : 0);
-			int loses = (whiteScore < 0 ? 1 : 0) + (blackScore < 0 ? 1 : 0);
-
-			return {(whiteScore + blackScore), wins, loses};
-		}
-
-		std::tuple<double, double, double> randomBenchmarker(int n = 1000) {
-			int result = 0;
-			int wins = 0;
-			int loses = 0;
-			for (int i = 0; i < n; i++) {
-				auto [score, win, lose] = randomBenchmarkerSingle();
-				result += score;
-				wins += win;
-				loses += lose;
-			}
-			return {(double) result / ((double)n * 2), (double)wins/((double)n * 2) * 100, (double) loses / ((double) n*2) * 100};
-		}
-		~ThreadSafePlayer() {
-			delete scoreMutex;
+			return moves[r];
 		}
 
 };
@@ -0,0 +1,198 @@
+#ifndef TRACE
+#define TRACE
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+
+// Timeline of spans in the Chrome trace-event format, for chrome://tracing or ui.perfetto.dev.
+// Off unless enabled, a disabled span costs one relaxed load. Every thread appends
+// to its own buffer without locking; buffers outlive their threads and are written
+// and emptied by dump(), which has to run while no traced thread is running.
+namespace Trace {
+
+	struct Event {
+		const char* name;
+		// Nanoseconds since the epoch of the tracer
+		uint64_t start;
+		uint64_t duration;
+		int64_t arg;
+		const char* argName;
+		// 'X' for a span, 'i' for an instant
+		char phase;
+	};
+
+	struct Buffer {
+		std::vector<Event> events;
+		std::atomic<size_t> size;
+		std::string threadName;
+		int tid;
+		// Cleared by the owning thread when it exits, the buffer is reused after the next dump
+		std::atomic<bool> owned;
+
+		Buffer(size_t capacity, int id) : events(capacity), size(0), tid(id), owned(true) {}
+	};
+
+	struct Registry {
+		std::mutex mutex;
+		std::vector<Buffer*> buffers;
+		std::vector<Buffer*> spare;
+		std::atomic<bool> enabled;
+		std::atomic<uint64_t> dropped;
+		size_t capacity = 1 << 16;
+		std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+		Registry() : enabled(false), dropped(0) {}
+	};
+
+	inline Registry& registry() {
+		static Registry* r = new Registry();
+		return *r;
+	}
+
+	inline bool enabled() {
+		return registry().enabled.load(std::memory_order_relaxed);
+	}
+
+	// Events per thread between dumps, later ones are dropped
+	inline void enable(const size_t capacity = 1 << 16) {
+		registry().capacity = capacity;
+		registry().enabled.store(true, std::memory_order_relaxed);
+	}
+
+	inline void disable() {
+		registry().enabled.store(false, std::memory_order_relaxed);
+	}
+
+	inline uint64_t now() {
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - registry().epoch).count();
+	}
+
+	// Takes a buffer when the thread first records and hands it back when the thread exits
+	struct Local {
+		Buffer* buffer;
+
+		Local() {
+			Registry& r = registry();
+			std::lock_guard<std::mutex> lock(r.mutex);
+			if (!r.spare.empty()) {
+				buffer = r.spare.back();
+				r.spare.pop_back();
+				buffer->owned.store(true, std::memory_order_relaxed);
+				buffer->threadName.clear();
+			} else {
+				buffer = new Buffer(r.capacity, r.buffers.size());
+				r.buffers.push_back(buffer);
+			}
+		}
+
+		~Local() {
+			buffer->owned.store(false, std::memory_order_release);
+		}
+	};
+
+	inline Buffer& local() {
+		static thread_local Local l;
+		return *l.buffer;
+	}
+
+	inline void append(const Event& e) {
+		Buffer& b = local();
+		size_t n = b.size.load(std::memory_order_relaxed);
+		if (n == b.events.size()) {
+			registry().dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		b.events[n] = e;
+		b.size.store(n + 1, std::memory_order_release);
+	}
+
+	// Label for the track of the calling thread
+	inline void nameThread(const std::string &name) {
+		if (enabled())
+			local().threadName = name;
+	}
+
+	inline void instant(const char* name, const char* argName = nullptr, const int64_t arg = 0) {
+		if (enabled())
+			append({name, now(), 0, arg, argName, 'i'});
+	}
+
+	// Records its lifetime, name has to be a string literal
+	class Span {
+
+		private:
+
+			const char* name;
+			const char* argName;
+			int64_t arg;
+			uint64_t start;
+			bool active;
+
+		public:
+
+			Span(const char* n, const char* a = nullptr, const int64_t v = 0) : name(n), argName(a), arg(v), start(0), active(enabled()) {
+				if (active)
+					start = now();
+			}
+
+			~Span() {
+				if (active)
+					append({name, start, now() - start, arg, argName, 'X'});
+			}
+	};
+
+	// Writes and empties every buffer, returns the number of events written
+	inline size_t dump(const std::string &filename) {
+		Registry& r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		std::ofstream file(filename);
+		if (!file) {
+			std::cerr << "Could not create " << filename << std::endl;
+			throw "Could not write trace";
+		}
+		size_t written = 0;
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		bool first = true;
+		auto separator = [&first, &file] {
+			if (!first)
+				file << ",\n";
+			first = false;
+		};
+		file.setf(std::ios::fixed);
+		file.precision(3);
+		for (auto b : r.buffers) {
+			size_t n = b->size.load(std::memory_order_acquire);
+			if (!b->threadName.empty()) {
+				separator();
+				file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << b->tid << ",\"args\":{\"name\":\"" << b->threadName << "\"}}";
+			}
+			for (size_t k = 0; k < n; k++) {
+				const Event& e = b->events[k];
+				separator();
+				file << "{\"name\":\"" << e.name << "\",\"ph\":\"" << e.phase << "\",\"pid\":0,\"tid\":" << b->tid << ",\"ts\":" << e.start / 1e3;
+				if (e.phase == 'X')
+					file << ",\"dur\":" << e.duration / 1e3;
+				else
+					file << ",\"s\":\"t\"";
+				if (e.argName)
+					file << ",\"args\":{\"" << e.argName << "\":" << e.arg << "}";
+				file << "}";
+			}
+			written += n;
+			b->size.store(0, std::memory_order_relaxed);
+			if (!b->owned.load(std::memory_order_acquire) && std::find(r.spare.begin(), r.spare.end(), b) == r.spare.end())
+				r.spare.push_back(b);
+		}
+		file << "\n]}\n";
+		return written;
+	}
+}
+
+#endif
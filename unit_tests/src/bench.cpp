@@ -0,0 +1,162 @@
+#include "benchmark.cpp"
+#include "supervisor.cpp"
+#include "activators.cpp"
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <thread>
+
+using namespace std;
+
+template<typename T>
+void matrixKernels(BenchmarkSuite &suite, const string &type) {
+    for (size_t n : {16, 64, 256}) {
+        string size = to_string(n);
+        Matrix<T> A = Matrix<T>::initializeRandom(n, n), B = Matrix<T>::initializeRandom(n, n), C(n, n);
+        double flops = 2.0 * n * n * n;
+        suite.run("matrix/gemm/" + type + "/" + size, [&] { Matrix<T>::gemm(A, B, C); keep(C); }, flops, "flop");
+        suite.run("matrix/product/" + type + "/" + size, [&] { keep(A ^ B); }, flops, "flop");
+        Matrix<T> D = A;
+        suite.run("matrix/add/" + type + "/" + size, [&] { D += B; keep(D); }, n * n, "element");
+        suite.run("matrix/transpose/" + type + "/" + size, [&] { keep(A.transpose()); }, n * n, "element");
+    }
+}
+
+template<typename T>
+void networks(BenchmarkSuite &suite, const string &type) {
+    Function<T> *s = new Sigmoid<T>(), *l = new Linear<T>();
+    for (auto sizes : vector<vector<size_t>>{{64, 32, 1}, {64, 256, 64, 1}}) {
+        string shape;
+        for (auto n : sizes)
+            shape += (shape.empty() ? "" : "-") + to_string(n);
+        NeuralNetwork<T> net(sizes, s, l);
+        GameState board;
+        Matrix<T> input = board.input<T>();
+        suite.run("network/evaluate/" + type + "/" + shape, [&] { keep(net.evaluate(input)); }, 1, "evaluation");
+        for (size_t batch : {1, 64, 1024}) {
+            Matrix<T> X = Matrix<T>::initializeRandom(batch, 64);
+            auto w = net.workspace(batch);
+            suite.run("network/forward/" + type + "/" + shape + "/" + to_string(batch), [&] { keep(net.forward(X, w)); }, batch, "evaluation");
+        }
+    }
+    delete s; delete l;
+}
+
+template<typename T>
+void selfplay(BenchmarkSuite &suite, const string &type) {
+    Function<T> *s = new Sigmoid<T>(), *l = new Linear<T>();
+    ThreadSafePlayer<T> p1({64, 32, 1}, s, l), p2({64, 32, 1}, s, l);
+    suite.run("game/selfplay/" + type + "/64-32-1", [&] { keep(ThreadSafePlayer<T>::eval(&p1, &p2)); }, 1, "game");
+    delete s; delete l;
+}
+
+void game(BenchmarkSuite &suite) {
+    GameState board;
+    suite.run("game/validMoves", [&] { keep(board.validMoves(1)); });
+    auto moves = board.validMoves(1);
+    auto [x, y] = moves[0];
+    suite.run("game/potentialBoard", [&] { keep(board.potentialBoard(x, y, 1)); });
+    GameState copy = board;
+    suite.run("game/placePiece", [&] { copy.board = board.board; copy.placePiece(x, y, 1); keep(copy); });
+    suite.run("game/random", [&] {
+        GameState g;
+        while (!g.isFinal()) {
+            int c = g.getColour();
+            auto m = g.validMoves(c);
+            auto [i, j] = m[RandomGenerator::randomInt(0, m.size() - 1)];
+            g.placePiece(i, j, c);
+        }
+        keep(g);
+    }, BOARD_SIZE - 4, "move");
+    selfplay<float>(suite, "float");
+    selfplay<double>(suite, "double");
+}
+
+template<typename T>
+void competition(BenchmarkSuite &suite, int maxThreads, const string &type) {
+    Function<T> *s = new Sigmoid<T>(), *l = new Linear<T>();
+    int players = 16;
+    vector<int> counts;
+    for (int t = 1; t < maxThreads; t *= 2)
+        counts.push_back(t);
+    counts.push_back(maxThreads);
+    for (int t : counts) {
+        string name = "competition/" + type + "/threads/" + to_string(t);
+        if (!suite.selected(name))
+            continue;
+        Supervisor<ThreadSafePlayer<T>> super(players, {64, 32, 1}, s, l);
+        super.setThreads(t);
+        super.playCompetition();
+        // Fastest of a few runs, a single one varies too much for the regression check
+        double fastest = 0;
+        for (int r = 0; r < suite.samples; r++) {
+            auto start = chrono::steady_clock::now();
+            super.playCompetition();
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            fastest = r ? min(fastest, seconds) : seconds;
+        }
+        suite.record(name, fastest, players * (players - 1), "game");
+    }
+    delete s; delete l;
+}
+
+void serialization(BenchmarkSuite &suite) {
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    NeuralNetwork<double> net({64, 256, 64, 1}, s, l);
+    string network = "/tmp/bench.ssvn", binary = "/tmp/bench.ssvb", checkpoint = "/tmp/bench.ssvc";
+    double parameters = 64 * 256 + 256 + 256 * 64 + 64 + 64 + 1;
+    suite.run("io/network/save", [&] { net.saveNetwork(network); }, parameters, "parameter");
+    NeuralNetwork<double> copy = net;
+    suite.run("io/network/read", [&] { copy.readNetwork(network); keep(copy); }, parameters, "parameter");
+    Matrix<double> m = Matrix<double>::initializeRandom(1024, 256);
+    double bytes = m.size() * sizeof(double);
+    suite.run("io/matrix/writeBinary", [&] { m.writeBinary(binary); }, bytes, "byte");
+    suite.run("io/matrix/readBinary", [&] { keep(Matrix<double>::readBinary(binary)); }, bytes, "byte");
+    Supervisor<> super(64, {64, 32, 1}, s, l);
+    suite.run("io/checkpoint/snapshot", [&] { keep(Checkpoint::snapshot(super.players, 0)); }, super.players.size(), "player");
+    auto c = Checkpoint::snapshot(super.players, 0);
+    suite.run("io/checkpoint/write", [&] { c.write(checkpoint); }, c.size(), "byte");
+    remove(network.c_str());
+    remove(binary.c_str());
+    remove(checkpoint.c_str());
+    delete s; delete l;
+}
+
+// Usage: bench [--filter text] [--out results.jsonl] [--baseline baseline.jsonl] [--threads n] [--seconds s] [--tolerance t]
+// Exits with 1 when a benchmark is slower than the baseline by more than the tolerance
+int main(int argc, char** argv) {
+    BenchmarkSuite suite;
+    string out, baseline;
+    int threads = max(1u, thread::hardware_concurrency());
+    double tolerance = 0.1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--filter"))
+            suite.filter = argv[i + 1];
+        else if (!strcmp(argv[i], "--out"))
+            out = argv[i + 1];
+        else if (!strcmp(argv[i], "--baseline"))
+            baseline = argv[i + 1];
+        else if (!strcmp(argv[i], "--threads"))
+            threads = stoi(argv[i + 1]);
+        else if (!strcmp(argv[i], "--seconds"))
+            suite.minSeconds = stod(argv[i + 1]);
+        else if (!strcmp(argv[i], "--tolerance"))
+            tolerance = stod(argv[i + 1]);
+    }
+
+    matrixKernels<float>(suite, "float");
+    matrixKernels<double>(suite, "double");
+    networks<float>(suite, "float");
+    networks<double>(suite, "double");
+    game(suite);
+    competition<float>(suite, threads, "float");
+    competition<double>(suite, threads, "double");
+    serialization(suite);
+
+    if (!out.empty())
+        suite.write(out);
+    int regressions = baseline.empty() ? 0 : suite.compare(baseline, tolerance);
+    if (regressions)
+        cout << regressions << " regressions" << endl;
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,30 @@
+#include "island.cpp"
+#include "activators.cpp"
+#include <iostream>
+#include <chrono>
+
+using namespace std;
+
+// Competition throughput of one process against islands with the same number of players in total
+int main(int argc, char** argv) {
+    int islands = argc > 1 ? stoi(argv[1]) : Affinity::numaNodes() * 2;
+    int playersPerIsland = 16, generations = 4;
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    cout << "NUMA nodes: " << Affinity::numaNodes() << ", islands: " << islands << endl;
+
+    Supervisor<> single(islands * playersPerIsland, {64, 32, 1}, s, l);
+    long n = single.players.size();
+    auto start = chrono::steady_clock::now();
+    single.evolve(generations, 0.001, 0.1, false, false);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Single process: " << n << " players, " << generations * n * (n - 1) / seconds << " games/s" << endl;
+
+    IslandModel<> model(islands, [s, l, playersPerIsland] {
+        return new Supervisor<>(playersPerIsland, {64, 32, 1}, s, l);
+    }, ThreadSafePlayer<>({64, 32, 1}, s, l), 2, 2);
+    model.run(generations, true, 0.5);
+    if (model.failed)
+        cout << model.failed << " islands failed" << endl;
+    cout << "Islands: " << islands << " x " << playersPerIsland << " players, " << model.gamesPerSecond() << " games/s" << endl;
+    delete s; delete l;
+}
@@ -4,15 +4,23 @@
 
 using namespace std;
 
+// Every row 0, 1, ..., 49
+Matrix<int> sample() {
+	vector<int> contents(50 * 50);
+	for (size_t i = 0; i < contents.size(); i++)
+		contents[i] = i % 50;
+	return Matrix<int>(50, 50, contents);
+}
+
 Matrix<int> matrixcrossproduct() {
-	Matrix<int> m1(50, 50, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49});
-	Matrix<int> m2(50, 50, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49});
+	Matrix<int> m1 = sample();
+	Matrix<int> m2 = sample();
 	return m1 ^ m2;
 }
 
-Matrix<int>& matrixcrossproduct2() {
-	Matrix<int> m1(50, 50, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49});
-	Matrix<int> m2(50, 50, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49});
+Matrix<int> matrixcrossproduct2() {
+	Matrix<int> m1 = sample();
+	Matrix<int> m2 = sample();
 	Matrix<int> m = m1 ^ m2;
 	return m;
 }
@@ -37,8 +45,8 @@ int main () {
 
 	cout << ((float) t) / CLOCKS_PER_SEC << endl;
 
-Matrix<int> m1(50, 50, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49});
-	Matrix<int> m2(50, 50, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49});
+Matrix<int> m1 = sample();
+	Matrix<int> m2 = sample();
 	
 	 t = clock();
 
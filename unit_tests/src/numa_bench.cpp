@@ -0,0 +1,91 @@
+#include "supervisor.cpp"
+#include "activators.cpp"
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+
+using namespace std;
+
+// Node of every page of every genome matrix, read with move_pages without moving anything.
+// Returns the fraction of pages on the node of the worker that plays the player's games.
+template<typename P>
+double localPages(Supervisor<P> &super, int workers, long &pages) {
+    long page = sysconf(_SC_PAGESIZE), local = 0;
+    int nodes = Affinity::numaNodes();
+    pages = 0;
+    int size = super.players.size();
+    for (int i = 0; i < size; i++) {
+        // Right after select() player i belongs to block i * workers / size
+        int node = (i * workers / size) % nodes;
+        vector<void*> addresses;
+        for (auto& m : super.players[i]->weights)
+            for (size_t b = 0; b < m.size() * sizeof(double); b += page)
+                addresses.push_back((char*) m.raw() + b);
+        vector<int> status(addresses.size());
+        if (syscall(SYS_move_pages, 0, addresses.size(), addresses.data(), nullptr, status.data(), 0) != 0)
+            continue;
+        for (int s : status) {
+            if (s < 0)
+                continue;
+            pages++;
+            local += s == node;
+        }
+    }
+    return pages ? (double) local / pages : 0;
+}
+
+long hugePagesKb() {
+    ifstream smaps("/proc/self/smaps_rollup");
+    string key;
+    long value;
+    while (smaps >> key) {
+        if (key == "AnonHugePages:" && smaps >> value)
+            return value;
+        smaps.ignore(1 << 10, '\n');
+    }
+    return 0;
+}
+
+// Competition throughput and population placement with and without pinned, node-local workers
+void run(const char* name, bool pin, bool huge, int players, int generations) {
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    Supervisor<> super(players, {64, 256, 64, 1}, s, l);
+    super.pinWorkers = pin;
+    super.hugepages = huge;
+    int workers = 4;
+    struct rusage before, after;
+    getrusage(RUSAGE_SELF, &before);
+    double competition = 0, selection = 0;
+    long n = players, pages = 0;
+    double local = 0;
+    for (int g = 0; g < generations; g++) {
+        auto start = chrono::steady_clock::now();
+        super.playCompetition();
+        auto played = chrono::steady_clock::now();
+        super.select();
+        auto selected = chrono::steady_clock::now();
+        local = localPages(super, workers, pages);
+        super.crossover(0.1);
+        super.mutate(0.001);
+        competition += chrono::duration<double>(played - start).count();
+        selection += chrono::duration<double>(selected - played).count();
+    }
+    getrusage(RUSAGE_SELF, &after);
+    cout << name << ": " << generations * n * (n - 1) / competition << " games/s, select " << 1000 * selection / generations << " ms"
+        << ", minor faults " << (after.ru_minflt - before.ru_minflt) / generations << "/generation"
+        << ", local genome pages " << 100 * local << "% of " << pages
+        << ", AnonHugePages " << hugePagesKb() << " kB" << endl;
+    delete s; delete l;
+}
+
+int main(int argc, char** argv) {
+    int players = argc > 1 ? stoi(argv[1]) : 32;
+    int generations = argc > 2 ? stoi(argv[2]) : 2;
+    cout << "NUMA nodes: " << Affinity::numaNodes() << ", CPUs: " << thread::hardware_concurrency() << endl;
+    run("Unpinned, heap", false, false, players, generations);
+    run("Pinned, arenas", true, false, players, generations);
+    run("Pinned, arenas, hugepages", true, true, players, generations);
+}
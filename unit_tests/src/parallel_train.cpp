@@ -0,0 +1,71 @@
+#include "paralleltrainer.cpp"
+#include "gamestate.cpp"
+#include "activators.cpp"
+#include <iostream>
+#include <fstream>
+#include <thread>
+
+using namespace std;
+
+// Positions of random games, target is the final score for the player who just moved
+void flippoData(size_t games, Matrix<double>& X, Matrix<double>& Y) {
+    size_t n = games * (BOARD_SIZE - 4);
+    X = Matrix<double>(n, BOARD_SIZE);
+    Y = Matrix<double>(n, 1);
+    size_t row = 0;
+    for (size_t g = 0; g < games; g++) {
+        GameState s;
+        vector<GameState> positions;
+        while (!s.isFinal()) {
+            int c = s.getColour();
+            auto moves = s.validMoves(c);
+            auto [i, j] = moves[RandomGenerator::randomInt(0, moves.size() - 1)];
+            s.placePiece(i, j, c);
+            positions.push_back(s);
+        }
+        for (auto &p : positions) {
+            int mover = -p.getColour();
+            for (int k = 0; k < BOARD_SIZE; k++)
+                X[row * BOARD_SIZE + k] = mover * p.board[k];
+            Y[row++] = mover * s.getScore() / MAX_SCORE;
+        }
+    }
+}
+
+double mse(NeuralNetwork<double>& nn, const Matrix<double>& X, const Matrix<double>& Y) {
+    Matrix<double> error = nn.evaluateBatch(X) - Y;
+    double result = 0;
+    for (size_t i = 0; i < error.size(); i++)
+        result += error[i] * error[i];
+    return result / X.rows;
+}
+
+void benchmark(const string& name, const Matrix<double>& X, const Matrix<double>& Y, vector<size_t> sizes, int epochs, double eta) {
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    cout << name << ": " << X.rows << " samples" << endl;
+    int cores = thread::hardware_concurrency();
+    for (int hogwild = 0; hogwild < 2; hogwild++) {
+        for (int threads = 1; threads <= cores; threads *= 2) {
+            NeuralNetwork<double> nn(sizes, s, l);
+            ParallelTrainer<double> trainer(&nn, threads);
+            double rate = trainer.train(X, Y, epochs, 64, eta, hogwild);
+            cout << (hogwild ? "  hogwild " : "  synchronous ") << threads << " threads: " << rate << " samples/sec, MSE " << mse(nn, X, Y) << endl;
+        }
+    }
+    delete s; delete l;
+}
+
+int main() {
+    Matrix<double> X, Y;
+    flippoData(500, X, Y);
+    benchmark("Flippo value", X, Y, {64, 32, 1}, 5, 0.05);
+
+    // Produced by converters/csv_ssv_converter.py
+    ifstream input("data/mnist_test_input.ssv"), output("data/mnist_test_output.ssv");
+    if (input && output) {
+        Matrix<double> mX = Matrix<double>::readFromFile(input), mY = Matrix<double>::readFromFile(output);
+        benchmark("MNIST", mX, mY, {784, 64, 10}, 3, 0.5);
+    } else {
+        cout << "No MNIST data in data/, skipping" << endl;
+    }
+}
@@ -1,7 +1,6 @@
 #include <iostream>
 #include "qlearner.cpp"
-#include "neural-network.cpp"
-#include "flippo.cpp"
+#include "threadsafeplayer.cpp"
 #include "activators.cpp"
 #include <csignal>
 
@@ -21,12 +20,16 @@ int main() {
 	cout << eta << endl;
 	signal(SIGINT, gracefulExit);
 	Function<double> *s = new LeakyRELU<double>(), *l = new TanH<double>();
-	NeuralNetwork<double> nn = NeuralNetwork<double>({64, 48, 32, 16, 1}, s, l);
-	ql = new QLearner(&nn, 1);
-	auto [score, wins, loses] = Flippo::randomBenchmarker(5000);
+	ThreadSafePlayer<> nn({64, 48, 32, 16, 1}, s, l);
+	ql = new QLearner(&nn, 1, 1 << 18, true);
+	// A batch from an empty buffer has to leave the network alone
+	double before = nn.weights[0][0];
+	ql->trainBatch(100, eta);
+	cout << "Empty replay batch: " << (ql->replaySize() == 0 && nn.weights[0][0] == before ? "skipped" : "FAILED") << endl;
+	auto [score, wins, loses] = nn.randomBenchmarker(5000);
 	std::cout << "Initial score: " << score << " Initial wins: " << wins << " Initial loses: " << loses << " Initial draws: " << (100 - loses - wins) << endl;
-	ql->replayTrain(5000, 100, eta, 1, 0.999, 1, -1, false, true, 10, 1000);
-	auto [score1, wins1, loses1] = Flippo::randomBenchmarker(5000);
-	std::cout << "Initial score: " << score1 << " Initial wins: " << wins1 << " Initial loses: " << loses1 << " Initial draws: " << (100 - loses1 - wins1) << endl;
+	ql->replayTrain(100, 100, eta, 1, 0.999, 100, 100, false, true, 10, 1000);
+	auto [score1, wins1, loses1] = nn.randomBenchmarker(5000);
+	std::cout << "Final score: " << score1 << " Final wins: " << wins1 << " Final loses: " << loses1 << " Final draws: " << (100 - loses1 - wins1) << endl;
 	delete s; delete l; delete ql;
 }
@@ -0,0 +1,20 @@
+#include "actorlearner.cpp"
+#include "activators.cpp"
+#include <iostream>
+
+using namespace std;
+
+int main() {
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    ThreadSafePlayer<> nn({64, 32, 1}, s, l);
+    QLearner ql(&nn, 1, 1 << 16);
+    ActorLearner pipeline(&ql, 3);
+
+    auto [score, wins, loses] = nn.randomBenchmarker(500);
+    cout << "Initial score: " << score << " Wins: " << wins << " Loses: " << loses << endl;
+    pipeline.run(2000, 64, 0.01, 0.2, 10, true, 500);
+    pipeline.report();
+    auto [score1, wins1, loses1] = nn.randomBenchmarker(500);
+    cout << "Final score: " << score1 << " Wins: " << wins1 << " Loses: " << loses1 << endl;
+    delete s; delete l;
+}
@@ -0,0 +1,62 @@
+#define TRACK_ALLOCATIONS
+#include "supervisor.cpp"
+#include "activators.cpp"
+#include <iostream>
+
+using namespace std;
+
+bool failed = false;
+
+// Regression check for loops that must not touch the heap
+template<typename F>
+void zero(const string &name, int n, F f) {
+    f();
+    Allocations::Scope scope;
+    for (int i = 0; i < n; i++)
+        f();
+    auto c = scope.counts();
+    cout << name << ": " << c.allocations << " allocations in " << n << " calls " << (c.allocations ? "FAILED" : "ok") << endl;
+    failed |= c.allocations != 0;
+}
+
+// Heap traffic per call of loops that still allocate
+template<typename F>
+void measure(const string &name, int n, F f) {
+    Allocations::Scope scope;
+    for (int i = 0; i < n; i++)
+        f();
+    auto c = scope.counts();
+    cout << name << ": " << (double) c.allocations / n << " allocations, " << (double) c.bytes / n << " bytes per call" << endl;
+}
+
+int main() {
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    ThreadSafePlayer<> player({64, 32, 1}, s, l);
+    auto batch = Matrix<double>::initializeRandom(64, 64);
+    auto w = player.workspace(64);
+    Matrix<double> A = Matrix<double>::initializeRandom(32, 64), B = Matrix<double>::initializeRandom(64, 16), C(32, 16);
+    GameState board;
+    auto moves = board.validMoves(1);
+    auto [x, y] = moves[0];
+
+    zero("Matrix::gemm", 100, [&] { Matrix<double>::gemm(A, B, C); });
+    zero("NeuralNetwork::forward with a workspace", 100, [&] { player.forward(batch, w); });
+    // Copies made beforehand, a copy allocates its board
+    vector<GameState> copies(101, board);
+    int k = 0;
+    zero("GameState::placePiece", 100, [&] { copies[k++].placePiece(x, y, 1); });
+
+    measure("NeuralNetwork::evaluate", 1000, [&] { player.evaluate(board.input()); });
+    measure("GameState::validMoves", 1000, [&] { board.validMoves(1); });
+    measure("ThreadSafePlayer::predictMove", 1000, [&] { player.predictMove(board); });
+    measure("Game", 20, [&] { ThreadSafePlayer<>::eval(&player, &player); });
+
+    Supervisor<> super(10, {64, 32, 1}, s, l);
+    super.evolve(1, 0.001, 0.1, false, false);
+    cout << "Generation: " << super.metrics.allocations << " allocations, " << super.metrics.allocatedBytes << " bytes, "
+        << super.metrics.gameAllocations / super.metrics.games << " per game" << endl;
+
+    delete s; delete l;
+    cout << (failed ? "Zero-allocation regression" : "Zero-allocation loops are allocation free") << endl;
+    return failed;
+}
@@ -0,0 +1,23 @@
+#include "alphabeta.cpp"
+#include "threadsafeplayer.cpp"
+#include "activators.cpp"
+#include <iostream>
+
+using namespace std;
+
+int main() {
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    ThreadSafePlayer<> p({64, 32, 1}, s, l);
+    AlphaBeta<ThreadSafePlayer<>> search(&p);
+    GameState g;
+
+    for (int depth = 1; depth <= 4; depth++) {
+        search.clear();
+        auto [i, j] = search.searchDepth(g, depth);
+        cout << "Depth " << depth << ": " << i << " " << j << " value " << search.bestValue << " nodes " << search.nodes << " nodes/sec " << search.nodesPerSecond() << endl;
+    }
+
+    auto [i, j] = search.search(g, 200);
+    cout << "200ms: " << i << " " << j << " depth " << search.completedDepth << " in " << search.seconds << "s, nodes/sec " << search.nodesPerSecond() << endl;
+    delete s; delete l;
+}
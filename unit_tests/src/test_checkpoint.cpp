@@ -0,0 +1,53 @@
+#include "supervisor.cpp"
+#include "activators.cpp"
+#include <iostream>
+#include <chrono>
+
+using namespace std;
+
+bool samePopulation(Supervisor<>& a, Supervisor<>& b) {
+    for (unsigned int p = 0; p < a.players.size(); p++) {
+        for (unsigned int i = 0; i < a.players[p]->weights.size(); i++)
+            if (a.players[p]->weights[i].getData() != b.players[p]->weights[i].getData())
+                return false;
+        if (a.players[p]->getScore() != b.players[p]->getScore())
+            return false;
+    }
+    return true;
+}
+
+int main() {
+    string filename = "/tmp/test_checkpoint.ssvc";
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    Supervisor<> original(20, {64, 32, 1}, s, l);
+    original.checkpointEvery(1, filename);
+    original.evolve(3, 0.001, 0.1, false, false);
+    original.checkpointWriter->flush();
+    cout << "Checkpoints written: " << original.checkpointWriter->written << " skipped: " << original.checkpointWriter->skipped << endl;
+
+    auto start = chrono::steady_clock::now();
+    auto snapshot = Checkpoint::snapshot(original.players, original.generation);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    cout << "Snapshot of " << snapshot.size() << " bytes in " << ms << " ms" << endl;
+
+    Supervisor<> resumed(20, {64, 32, 1}, s, l);
+    cout << "Resumed: " << resumed.resume(filename) << " at generation " << resumed.generation << endl;
+    cout << "Same population: " << samePopulation(original, resumed) << endl;
+
+    // Both continue from the same genomes, scores and random state. The generator
+    // is per thread, so it is restored again before the second one continues
+    original.checkpointRate = resumed.checkpointRate = 0;
+    original.evolve(1, 0.001, 0.1, false, false);
+    resumed.resume(filename);
+    resumed.evolve(1, 0.001, 0.1, false, false);
+    cout << "Same after another generation: " << samePopulation(original, resumed) << endl;
+
+    Supervisor<> other(10, {64, 32, 1}, s, l);
+    try {
+        other.resume(filename);
+    } catch (const char* e) {
+        cout << "Mismatched population: " << e << endl;
+    }
+    remove(filename.c_str());
+    delete s; delete l;
+}
@@ -0,0 +1,79 @@
+#define CSV_CONVERTER_LIBRARY
+#include "../../converters/csv_converter.cpp"
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+// Converts csv with the options and reads the result back with Matrix::readBinary
+template<typename T>
+Matrix<T> roundTrip(const string &csv, const Options &o) {
+    string in = "/tmp/test_csv_converter.csv", out = "/tmp/test_csv_converter.ssvb";
+    {
+        ofstream file(in, ios::binary);
+        file << csv;
+    }
+    FILE* f = fopen(in.c_str(), "rb");
+    {
+        ofstream file(out, ios::binary);
+        convert<T>(f, file, o);
+    }
+    fclose(f);
+    Matrix<T> m = Matrix<T>::readBinary(out);
+    remove(in.c_str());
+    remove(out.c_str());
+    return m;
+}
+
+template<typename T>
+bool same(const Matrix<T> &m, const size_t rows, const size_t columns, const vector<double> &expected) {
+    if (m.rows != rows || m.columns != columns)
+        return false;
+    for (size_t i = 0; i < expected.size(); i++)
+        if (fabs(m.raw()[i] - expected[i]) > 1e-6)
+            return false;
+    return true;
+}
+
+int main() {
+    Matrix<double> all = roundTrip<double>("0.5,1.25,-2\n255,0,1e-3\n", Options());
+    cout << "Plain: " << same(all, 2, 3, {0.5, 1.25, -2, 255, 0, 1e-3}) << endl;
+
+    // Label column first, Windows line ends, spaces and a trailing empty line
+    string csv = "3, 0.5,1.25,-2\r\n1,255,0,1e-3\r\n\r\n";
+    Options o;
+    o.skip = 1;
+    o.normalization = 255;
+    Matrix<double> inputs = roundTrip<double>(csv, o);
+    cout << "Skipped and normalized: " << same(inputs, 2, 3, {0.5 / 255, 1.25 / 255, -2.0 / 255, 1, 0, 1e-3 / 255}) << endl;
+
+    o = Options();
+    o.end = 1;
+    o.onehot = 4;
+    Matrix<float> labels = roundTrip<float>(csv, o);
+    cout << "One-hot as float: " << same(labels, 2, 4, {0, 0, 0, 1, 0, 1, 0, 0}) << endl;
+
+    // Chunks smaller than a line, lines are carried over and split between threads
+    string many;
+    vector<double> expected;
+    for (int r = 0; r < 1000; r++) {
+        for (int c = 0; c < 5; c++) {
+            many += (c ? "," : "") + to_string(r * 5 + c);
+            expected.push_back(r * 5 + c);
+        }
+        many += "\n";
+    }
+    o = Options();
+    o.chunkBytes = 16;
+    o.threads = 3;
+    Matrix<double> chunked = roundTrip<double>(many, o);
+    cout << "Small chunks: " << same(chunked, 1000, 5, expected) << endl;
+
+    o = Options();
+    try {
+        roundTrip<double>("1,2\n3\n", o);
+        cout << "Ragged rows accepted" << endl;
+    } catch (const char* e) {
+        cout << "Ragged rows: " << e << endl;
+    }
+}
@@ -0,0 +1,80 @@
+#include "dataset.cpp"
+#include "neural-network.cpp"
+#include "activators.cpp"
+#include <iostream>
+#include <chrono>
+
+using namespace std;
+
+// Learns the sum of the inputs from a dataset written as .ssvb files
+int main() {
+    size_t rows = 100000, columns = 64;
+    Matrix<double> X = Matrix<double>::initializeRandom(rows, columns, 0, 1), Y(rows, 1);
+    for (size_t r = 0; r < rows; r++) {
+        double sum = 0;
+        for (size_t c = 0; c < columns; c++)
+            sum += X.raw()[r * columns + c];
+        Y[r] = sum / columns;
+    }
+    X.writeBinary("/tmp/test_dataset_x.ssvb");
+    Y.writeBinary("/tmp/test_dataset_y.ssvb");
+
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    for (bool prefetch : {false, true}) {
+        NeuralNetwork<double> nn({64, 32, 1}, s, l);
+        auto w = nn.workspace(0);
+        Dataset<double> data("/tmp/test_dataset_x.ssvb", "/tmp/test_dataset_y.ssvb", 128, prefetch);
+
+        // Rows are views into the mapping
+        cout << "Row 7 matches: " << (data.inputRow(7)[3] == X.raw()[7 * columns + 3] && data.targetRow(7)[0] == Y[7]) << endl;
+
+        auto start = chrono::steady_clock::now();
+        size_t samples = 0;
+        Dataset<double>::Batch batch;
+        for (int epoch = 0; epoch < 5; epoch++) {
+            while (data.next(batch)) {
+                nn.updateBatch(batch.inputs, batch.targets, batch.size, 0.05, w);
+                samples += batch.size;
+            }
+        }
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        auto view = data.rows(0, 1000);
+        const Matrix<double>& out = nn.forward(view.inputs, view.size, w);
+        double error = 0;
+        for (size_t r = 0; r < view.size; r++)
+            error += (out[r] - view.targets[r]) * (out[r] - view.targets[r]);
+        cout << (prefetch ? "Prefetch: " : "Inline: ") << samples << " samples, " << samples / seconds << " samples/s, MSE " << error / view.size << endl;
+
+        bool thrown = false;
+        try {
+            data.rows(rows + 1, 10);
+        } catch (const char* e) {
+            thrown = true;
+        }
+        cout << "Rows past the end rejected: " << thrown << ", tail size: " << data.rows(rows - 5, 10).size << endl;
+    }
+
+    bool thrown = false;
+    try {
+        Dataset<double> none("/tmp/test_dataset_x.ssvb", "/tmp/test_dataset_y.ssvb", 0);
+    } catch (const char* e) {
+        thrown = true;
+    }
+    cout << "Batch size 0 rejected: " << thrown << endl;
+
+    Matrix<double>(0, columns).writeBinary("/tmp/test_dataset_empty_x.ssvb");
+    Matrix<double>(0, 1).writeBinary("/tmp/test_dataset_empty_y.ssvb");
+    thrown = false;
+    try {
+        Dataset<double> none("/tmp/test_dataset_empty_x.ssvb", "/tmp/test_dataset_empty_y.ssvb", 128);
+    } catch (const char* e) {
+        thrown = true;
+    }
+    cout << "Empty dataset rejected: " << thrown << endl;
+    remove("/tmp/test_dataset_empty_x.ssvb");
+    remove("/tmp/test_dataset_empty_y.ssvb");
+    remove("/tmp/test_dataset_x.ssvb");
+    remove("/tmp/test_dataset_y.ssvb");
+    delete s; delete l;
+}
@@ -0,0 +1,61 @@
+#include "endgame.cpp"
+#include "randomgenerator.cpp"
+#include "threadpool.cpp"
+#include <iostream>
+#include <chrono>
+
+using namespace std;
+
+// Reference minimax on GameState, only feasible for a few empties
+int bruteForce(const GameState& s) {
+    int c = s.getColour();
+    if (s.isFinal())
+        return c * s.getScore();
+    int best = -BOARD_SIZE - 1;
+    for (auto [i, j] : s.validMoves(c))
+        best = max(best, -bruteForce(s.potentialBoard(i, j, c)));
+    return best;
+}
+
+GameState randomPosition(int empties) {
+    GameState s;
+    while (BOARD_SIZE - s.moves > empties) {
+        int c = s.getColour();
+        auto moves = s.validMoves(c);
+        auto [i, j] = moves[RandomGenerator::randomInt(0, moves.size() - 1)];
+        s.placePiece(i, j, c);
+    }
+    return s;
+}
+
+int main() {
+    EndgameSolver solver;
+
+    cout << "Checking against brute force" << endl;
+    int mismatches = 0;
+    for (int n = 0; n < 200; n++) {
+        GameState s = randomPosition(6);
+        if (solver.solve(s) != bruteForce(s))
+            mismatches++;
+    }
+    cout << "Mismatches: " << mismatches << endl;
+
+    for (int empties = 6; empties <= 12; empties += 2) {
+        int positions = 50;
+        solver.nodes = 0;
+        auto start = chrono::steady_clock::now();
+        for (int n = 0; n < positions; n++)
+            solver.bestMove(randomPosition(empties));
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << empties << " empties: " << positions / seconds << " positions/sec, " << solver.nodes / seconds << " nodes/sec" << endl;
+    }
+
+    ThreadPool pool;
+    GameState s = randomPosition(12);
+    int score;
+    long nodes;
+    auto start = chrono::steady_clock::now();
+    auto [i, j] = EndgameSolver::bestMoveParallel(s, pool, &score, &nodes);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Parallel 12 empties on " << pool.size() << " threads: " << i << " " << j << " score " << score << " in " << seconds << "s, " << nodes / seconds << " nodes/sec" << endl;
+}
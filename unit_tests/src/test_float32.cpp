@@ -0,0 +1,76 @@
+#include "supervisor.cpp"
+#include "activators.cpp"
+#include "mcts.cpp"
+#include "alphabeta.cpp"
+#include <iostream>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+using namespace std;
+
+template<typename T>
+size_t populationBytes(Supervisor<ThreadSafePlayer<T>> &super) {
+    size_t n = 0;
+    for (auto p : super.players)
+        n += p->parameterCount() * sizeof(T);
+    return n;
+}
+
+template<typename T>
+double gamesPerSecond(int games) {
+    Function<T> *s = new Sigmoid<T>(), *l = new Linear<T>();
+    ThreadSafePlayer<T> p1({64, 256, 64, 1}, s, l), p2({64, 256, 64, 1}, s, l);
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < games; i++)
+        ThreadSafePlayer<T>::eval(&p1, &p2);
+    double seconds = Metrics::seconds(start);
+    delete s; delete l;
+    return games / seconds;
+}
+
+int main() {
+    Function<float> *sf = new Sigmoid<float>(), *lf = new Linear<float>();
+    Function<double> *sd = new Sigmoid<double>(), *ld = new Linear<double>();
+
+    // The whole evolution loop in single precision
+    Supervisor<ThreadSafePlayer<float>> single(12, {64, 32, 1}, sf, lf);
+    Supervisor<ThreadSafePlayer<double>> twice(12, {64, 32, 1}, sd, ld);
+    single.evolve(2, 0.001, 0.1, false, true, 2, 200);
+    cout << "Float generations: " << single.generation << ", games " << single.metrics.games << endl;
+    cout << "Population: " << populationBytes(single) << " bytes as float, " << populationBytes(twice) << " as double" << endl;
+
+    // .ssvn files are read back exactly, and convert between precisions
+    string filename = "/tmp/test_float32.ssvn";
+    ThreadSafePlayer<float>& best = *single.players[0];
+    best.saveNetwork(filename);
+    ThreadSafePlayer<float> readFloat(filename);
+    ThreadSafePlayer<double> readDouble(filename);
+    GameState board;
+    float f = best.evaluate(board.input<float>())[0];
+    cout << "Float round trip exact: " << (readFloat.weights[0].getData() == best.weights[0].getData() && readFloat.evaluate(board.input<float>())[0] == f) << endl;
+    cout << "Read as double within float precision: " << (abs(readDouble.evaluate(board.input())[0] - f) < 1e-5) << endl;
+    cout << "Same moves in both precisions: " << (readDouble.predictMove(board) == best.predictMove(board)) << endl;
+
+    // Checkpoints resume in the other precision
+    string checkpoint = "/tmp/test_float32.ssvc";
+    single.checkpointFile = checkpoint;
+    single.checkpoint();
+    single.checkpointWriter->flush();
+    cout << "Float checkpoint resumed as double: " << twice.resume(checkpoint) << ", same weights: "
+        << (twice.players[3]->weights[1].cast<float>().getData() == single.players[3]->weights[1].getData()) << endl;
+
+    // Searches take the scalar type of their evaluator
+    AlphaBeta<ThreadSafePlayer<float>> search(&best, 3);
+    MCTS<ThreadSafePlayer<float>> mcts(&best, 200);
+    auto [i, j] = search.predictMove(board);
+    auto [k, m] = mcts.predictMove(board);
+    cout << "Search moves valid: " << (board.potentialBoard(i, j, 1).moves == 5 && board.potentialBoard(k, m, 1).moves == 5) << endl;
+
+    double fast = gamesPerSecond<float>(200), slow = gamesPerSecond<double>(200);
+    cout << "Self-play 64-256-64-1: " << fast << " games/s as float, " << slow << " as double" << endl;
+
+    remove(filename.c_str());
+    remove(checkpoint.c_str());
+    delete sf; delete lf; delete sd; delete ld;
+}
@@ -0,0 +1,64 @@
+#include "supervisor.cpp"
+#include "activators.cpp"
+#include <iostream>
+#include <chrono>
+
+using namespace std;
+
+// Fastest generation, the least disturbed by the rest of the machine
+double competitionSeconds(Supervisor<>& super, int rounds) {
+    double best = 0;
+    for (int r = 0; r < rounds; r++) {
+        auto start = chrono::steady_clock::now();
+        super.playCompetition();
+        super.generation++;
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        if (r == 0 || seconds < best)
+            best = seconds;
+    }
+    return best;
+}
+
+int main() {
+    string filename = "/tmp/test_gamelog.bin";
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    Supervisor<> super(40, {64, 32, 1}, s, l);
+    int rounds = 5;
+    size_t games = 40 * 39;
+
+    // Both runs with the same number of workers
+    super.setThreads(8);
+    double plain = competitionSeconds(super, rounds);
+    super.setThreads(2);
+    super.logGames(filename);
+    // More workers than the log was opened with
+    super.setThreads(8);
+    double logged = competitionSeconds(super, rounds);
+    cout << "Without log: " << games / plain << " games/s, with log: " << games / logged << " games/s, overhead: " << (logged / plain - 1) * 100 << "%" << endl;
+    super.stopLogging();
+
+    GameLogReader reader(filename);
+    cout << "Games: " << reader.size() << " in " << reader.blocks().size() << " blocks, " << GameRecord::packedSize << " bytes per game" << endl;
+
+    // Replaying every game has to reproduce its score
+    int mismatches = 0;
+    long positions = 0;
+    auto start = chrono::steady_clock::now();
+    reader.forEach([&] (const GameRecord& r, uint32_t) {
+        int score = 0;
+        r.replay([&] (const GameState& state, int) {
+            positions++;
+            score = state.getScore();
+        });
+        if (score != r.score)
+            mismatches++;
+    });
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Replayed " << positions << " positions, " << positions / seconds << " positions/s, mismatches: " << mismatches << endl;
+
+    GameRecord last = reader[reader.size() - 1];
+    cout << "Last game: " << last.white << " vs " << last.black << " score " << (int) last.score << endl;
+
+    remove(filename.c_str());
+    delete s; delete l;
+}
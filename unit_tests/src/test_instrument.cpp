@@ -0,0 +1,47 @@
+#define INSTRUMENT
+#include "supervisor.cpp"
+#include "activators.cpp"
+#include <iostream>
+#include <cmath>
+
+using namespace std;
+
+int main() {
+    // Known distribution: 1..100000 ns once each
+    Instrument::Snapshot before = Instrument::snapshot();
+    std::thread recorder([] {
+        for (uint64_t ns = 1; ns <= 100000; ns++)
+            Instrument::record(Instrument::placePiece, ns);
+    });
+    recorder.join();
+    // The recorder has exited, its data is in the retired sum
+    Instrument::Snapshot known = Instrument::snapshot().since(before);
+    bool accurate = true;
+    for (double q : {0.5, 0.99, 0.999}) {
+        double p = known.percentile(Instrument::placePiece, q);
+        cout << "p" << q * 100 << ": " << p << " ns, exact " << q * 100000 << endl;
+        accurate &= fabs(p - q * 100000) / (q * 100000) < 0.03;
+    }
+    cout << (accurate ? "Percentiles within 3%" : "Percentiles off") << endl;
+
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    Supervisor<> super(10, {64, 32, 1}, s, l);
+    super.players[0]->endgameEmpties = 6;
+    Instrument::Snapshot start = Instrument::snapshot();
+    {
+        Instrument::Reporter reporter(0.2);
+        super.evolve(2, 0.001, 0.1, false, false);
+    }
+    Instrument::Snapshot run = Instrument::snapshot().since(start);
+    cout << "Whole run:" << endl;
+    run.print(cout);
+    bool ordered = true;
+    for (int p = 0; p < Instrument::probes; p++) {
+        Instrument::Probe probe = (Instrument::Probe) p;
+        double p50 = run.percentile(probe, 0.5), p99 = run.percentile(probe, 0.99), p999 = run.percentile(probe, 0.999);
+        ordered &= p50 <= p99 && p99 <= p999 && p999 <= run.histograms[p].max;
+    }
+    cout << (ordered ? "p50 <= p99 <= p999 <= max" : "Percentiles out of order") << endl;
+    cout << (run.counts[Instrument::games] == 2 * 10 * 9 && run.histograms[Instrument::game].total == 2 * 10 * 9 ? "Game count is correct" : "Game count is wrong") << endl;
+    delete s; delete l;
+}
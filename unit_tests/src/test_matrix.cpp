@@ -53,4 +53,8 @@ int main() {
 	std::cout << "Reading A and B" << std::endl;
 	std::ifstream file2("Test2.ssv");
 	std::cout << 	Matrix<double>::readFromFile(file2) << std::endl << Matrix<double>::readFromFile(file2);
+	std::cout << "Testing binary reading and writing" << std::endl;
+	c.writeBinary("Test.ssvb");
+	std::cout << Matrix<double>::readBinary("Test.ssvb") << std::endl;
+	std::cout << "As float:\n" << Matrix<float>::readBinary("Test.ssvb") << std::endl;
 }
@@ -0,0 +1,35 @@
+#include "mcts.cpp"
+#include "threadsafeplayer.cpp"
+#include "activators.cpp"
+#include <iostream>
+#include <thread>
+
+using namespace std;
+
+int main() {
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    ThreadSafePlayer<> p({64, 32, 1}, s, l);
+    GameState g;
+
+    int cores = thread::hardware_concurrency();
+    for (int threads = 1; threads <= cores; threads *= 2) {
+        MCTS<ThreadSafePlayer<>> mcts(&p, 20000, threads);
+        auto [i, j] = mcts.search(g, 20000);
+        cout << threads << " threads: " << i << " " << j << " " << mcts.playoutsPerSecond() << " playouts/sec, nodes " << mcts.nodesUsed() << endl;
+    }
+
+    // Tree reuse after our move and a reply
+    MCTS<ThreadSafePlayer<>> mcts(&p, 2000);
+    auto [i, j] = mcts.predictMove(g);
+    g.placePiece(i, j, 1);
+    auto moves = g.validMoves(-1);
+    auto [x, y] = moves[0];
+    g.placePiece(x, y, -1);
+    size_t before = mcts.nodesUsed();
+    mcts.predictMove(g);
+    cout << "Nodes before reuse " << before << ", after " << mcts.nodesUsed() << endl;
+
+    auto [score, wins, loses] = p.benchmarker(mcts, 5);
+    cout << "Against MCTS, Score: " << score << " Wins: " << wins << " Loses: " << loses << endl;
+    delete s; delete l;
+}
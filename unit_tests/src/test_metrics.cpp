@@ -0,0 +1,41 @@
+#include "supervisor.cpp"
+#include "activators.cpp"
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+
+using namespace std;
+
+int countLines(const string &filename) {
+    ifstream file(filename);
+    string line;
+    int n = 0;
+    while (getline(file, line))
+        n++;
+    return n;
+}
+
+int main() {
+    string json = "/tmp/test_metrics.jsonl", csv = "/tmp/test_metrics.csv";
+    remove(json.c_str());
+    remove(csv.c_str());
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    {
+        Supervisor<> super(12, {64, 32, 1}, s, l);
+        super.logMetrics(json);
+        super.evolve(2, 0.001, 0.1, true, true, 1, 50);
+        super.logMetrics(csv);
+        super.evolve(2, 0.001, 0.1, false, false);
+        GenerationMetrics& m = super.metrics;
+        cout << "Games: " << m.games << " Evaluations: " << m.evaluations << " Positions: " << m.positions << endl;
+        cout << (m.games == 12 * 11 && m.positions == m.games * 60 && m.evaluations > m.positions ? "Counts are correct" : "Counts are wrong") << endl;
+        cout << (m.utilization > 0 && m.utilization <= 1.01 ? "Utilization in range" : "Utilization out of range") << endl;
+    }
+    // Both loggers are closed now and have written everything
+    cout << "JSON lines: " << countLines(json) << ", CSV lines: " << countLines(csv) << " (expected 2 and 3)" << endl;
+    ifstream file(json);
+    string line;
+    getline(file, line);
+    cout << line << endl;
+    delete s; delete l;
+}
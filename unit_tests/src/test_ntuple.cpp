@@ -0,0 +1,44 @@
+#include "ntupleplayer.cpp"
+#include "supervisor.cpp"
+#include <iostream>
+#include <set>
+#include <algorithm>
+
+using namespace std;
+
+int main() {
+    NTuplePlayer p;
+    GameState g;
+    cout << "Instances: " << p.numInstances() << endl;
+
+    // No two instances may cover the same squares, whatever their order
+    set<vector<int>> sets;
+    for (auto instance : p.getInstances()) {
+        sort(instance.begin(), instance.end());
+        sets.insert(instance);
+    }
+    cout << "Distinct square sets: " << (sets.size() == (size_t) p.numInstances()) << endl;
+    cout << "Start value: " << p.evaluate(g.input()) << endl;
+
+    // Incremental indices have to match a full re-index, for every move of a random game
+    bool same = true;
+    for (GameState s; !s.isFinal();) {
+        int c = s.getColour();
+        auto moves = s.validMoves(c);
+        for (auto [i, j] : moves) {
+            auto idx = p.indices(c*s.input());
+            p.applyMove(idx, s, i, j, c);
+            same = same && idx == p.indices(c*s.potentialBoard(i, j, c).input());
+        }
+        auto [i, j] = moves[RandomGenerator::randomInt(0, moves.size() - 1)];
+        s.placePiece(i, j, c);
+    }
+    cout << "Incremental equals full: " << same << endl;
+
+    p.saveNetwork("test.ssvt");
+    NTuplePlayer q("test.ssvt");
+    cout << "Read value: " << q.evaluate(g.input()) << endl;
+
+    Supervisor<NTuplePlayer> super(8);
+    super.evolve(2, 0.01, 0.1, true, true, 1, 100);
+}
@@ -0,0 +1,20 @@
+#include "threadsafeplayer.cpp"
+#include "activators.cpp"
+#include <iostream>
+
+using namespace std;
+
+int main() {
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    ThreadSafePlayer<> policy({64, 32, 64}, s, l);
+    cout << "Is policy: " << policy.isPolicy() << endl;
+    GameState g;
+    auto [i, j] = policy.predictMove(g);
+    cout << "Chosen move: " << i << " " << j << endl;
+    policy.saveNetwork("test_policy.ssvn");
+    NeuralNetwork<double> read("test_policy.ssvn");
+    cout << "Read output size: " << read.getOutputSize() << endl;
+    auto [score, wins, loses] = policy.randomBenchmarker(100);
+    cout << "Score: " << score << " Wins: " << wins << " Loses: " << loses << endl;
+    delete s; delete l;
+}
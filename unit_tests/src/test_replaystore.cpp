@@ -0,0 +1,92 @@
+#include "replaystore.cpp"
+#include "threadsafeplayer.cpp"
+#include "activators.cpp"
+#include <iostream>
+#include <chrono>
+
+using namespace std;
+
+// Random games, every position is labelled with the final result for the player who moved
+void randomGames(ReplayWriter& writer, int n) {
+    for (int g = 0; g < n; g++) {
+        GameState s;
+        vector<tuple<Bitboard, int>> positions;
+        while (!s.isFinal()) {
+            int c = s.getColour();
+            auto moves = s.validMoves(c);
+            auto [i, j] = moves[RandomGenerator::randomInt(0, moves.size() - 1)];
+            s.placePiece(i, j, c);
+            positions.push_back({Bitboard(s, c), c});
+        }
+        for (auto [b, c] : positions)
+            writer.add(b, c * s.getScore() / MAX_SCORE);
+    }
+}
+
+int main() {
+    string dir = "/tmp/replaystore_test";
+    filesystem::remove_all(dir);
+
+    auto start = chrono::steady_clock::now();
+    {
+        ReplayWriter writer(dir, 1 << 16);
+        vector<thread> threads;
+        for (int t = 0; t < 2; t++)
+            threads.emplace_back(randomGames, ref(writer), 5000);
+        for (auto &t : threads)
+            t.join();
+        writer.close();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "Written: " << writer.written << " records, " << writer.written / seconds << " records/s, stalls: " << writer.stalls << ", failed: " << writer.failed << endl;
+    }
+
+    ReplayStore store(dir);
+    cout << "Store size: " << store.size() << " (" << store.size() * sizeof(ReplayRecord) / (1 << 20) << " MiB)" << endl;
+
+    // Round trip of the first game
+    const ReplayRecord& first = store[0];
+    cout << "First record pieces: " << __builtin_popcountll(first.own | first.opp) << " target: " << first.target << endl;
+
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    ThreadSafePlayer<> nn({64, 32, 1}, s, l);
+    auto workspace = nn.workspace(0);
+    const size_t batch = 256;
+    vector<size_t> current(batch), next(batch);
+    Matrix<double> X, Y;
+    store.sample(current.data(), batch);
+
+    start = chrono::steady_clock::now();
+    int batches = 2000;
+    for (int b = 0; b < batches; b++) {
+        store.sample(next.data(), batch);
+        store.willNeed(next.data(), batch);
+        store.fill(current.data(), batch, X, Y);
+        nn.updateBatch(X, Y, 0.01, workspace);
+        swap(current, next);
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Trained " << batches << " minibatches, " << batches * batch / seconds << " samples/s" << endl;
+
+    // Appending to an existing store continues with a new segment
+    {
+        ReplayWriter writer(dir, 1 << 16);
+        randomGames(writer, 10);
+    }
+    size_t before = store.size();
+    store.refresh();
+    cout << "After append: " << store.size() << " (+" << store.size() - before << ")" << endl;
+
+    // Nothing to sample from before the first segment exists
+    string empty = dir + "/empty";
+    filesystem::create_directories(empty);
+    ReplayStore none(empty);
+    try {
+        none.sample(current.data(), batch);
+        cout << "Sampled an empty store" << endl;
+    } catch (const char* e) {
+        cout << "Empty store: " << e << endl;
+    }
+
+    filesystem::remove_all(dir);
+    delete s; delete l;
+}
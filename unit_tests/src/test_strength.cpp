@@ -0,0 +1,44 @@
+#include "supervisor.cpp"
+#include "activators.cpp"
+#include <iostream>
+#include <chrono>
+
+using namespace std;
+
+int main() {
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    ThreadSafePlayer<> player({64, 32, 1}, s, l);
+    ThreadPool pool(4);
+
+    auto start = chrono::steady_clock::now();
+    auto [score, wins, loses] = player.randomBenchmarker(1000);
+    double serial = Metrics::seconds(start);
+    cout << "Serial:   wins " << wins << "% loses " << loses << "% in " << serial << " s" << endl;
+
+    // Without a target margin every round is played
+    start = chrono::steady_clock::now();
+    StrengthEstimate all = player.randomBenchmarker(pool, 1000, 0);
+    double parallel = Metrics::seconds(start);
+    cout << "Parallel: wins " << all.wins << "% loses " << all.loses << "% in " << parallel << " s, " << all.games << " games (+-" << all.margin << "%)" << endl;
+    cout << (all.games == 2000 ? "All rounds played" : "Rounds missing") << endl;
+    cout << (abs(all.wins - wins) < 2 * all.margin + 1 ? "Estimates agree" : "Estimates disagree") << endl;
+
+    // A loose target stops early
+    StrengthEstimate early = player.randomBenchmarker(pool, 1000, 0.05);
+    cout << "Target 5%: " << early.games << " games (+-" << early.margin << "%)" << endl;
+    cout << (early.games < 2000 && early.margin < 5 + 0.5 ? "Stopped early" : "Did not stop early") << endl;
+
+    // The strength test of generation 0 overlaps the competition of generation 1
+    {
+        Supervisor<> super(12, {64, 32, 1}, s, l);
+        super.backgroundBenchmark = true;
+        super.benchmarkMargin = 0.03;
+        start = chrono::steady_clock::now();
+        super.evolve(2, 0.001, 0.1, false, true, 2, 2000);
+        double evolved = Metrics::seconds(start);
+        super.waitForBenchmark();
+        cout << "Evolve returned after " << evolved << " s, test done after " << Metrics::seconds(start) << " s" << endl;
+        cout << "Background test: " << super.lastStrength().games << " games" << endl;
+    }
+    delete s; delete l;
+}
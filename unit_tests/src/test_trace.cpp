@@ -0,0 +1,41 @@
+#include "supervisor.cpp"
+#include "activators.cpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+
+int count(const string &text, const string &pattern) {
+    int n = 0;
+    for (size_t p = text.find(pattern); p != string::npos; p = text.find(pattern, p + 1))
+        n++;
+    return n;
+}
+
+int main() {
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    Supervisor<> super(10, {64, 32, 1}, s, l);
+    super.pinWorkers = true;
+    super.traceTo("/tmp/test_trace");
+    super.evolve(2, 0.001, 0.1, false, false);
+
+    // A batch evaluation on this thread ends up in the next dump
+    NeuralNetwork<double> net({64, 32, 1}, s, l);
+    net.evaluateBatch(Matrix<double>::initializeRandom(256, 64));
+    Trace::dump("/tmp/test_trace-batch.json");
+
+    for (string file : {"/tmp/test_trace-1.json", "/tmp/test_trace-2.json", "/tmp/test_trace-batch.json"}) {
+        ifstream in(file);
+        stringstream text;
+        text << in.rdbuf();
+        string t = text.str();
+        cout << file << ": " << count(t, "\"name\":\"game\"") << " games, " << count(t, "\"name\":\"steal\"") << " steals, "
+            << count(t, "\"name\":\"clone\"") << " clones, " << count(t, "\"name\":\"forward\"") << " batch evaluations, phases:"
+            << (t.find("\"competition\"") != string::npos ? " competition" : "") << (t.find("\"select\"") != string::npos ? " select" : "")
+            << (t.find("\"mutate\"") != string::npos ? " mutate" : "") << endl;
+    }
+    cout << "Dropped events: " << Trace::registry().dropped << endl;
+    cout << "Open the files in ui.perfetto.dev or chrome://tracing" << endl;
+    delete s; delete l;
+}
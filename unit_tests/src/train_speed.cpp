@@ -0,0 +1,73 @@
+#include "neural-network.cpp"
+#include "activators.cpp"
+#include "matrix.cpp"
+#include <iostream>
+#include <chrono>
+#include <cmath>
+
+using namespace std;
+
+int main() {
+    Function<double> *s = new Sigmoid<double>(), *l = new Linear<double>();
+    NeuralNetwork<double> nn({64, 32, 1}, s, l);
+    size_t batch = 64, batches = 200;
+
+    vector<Matrix<double>> data, target;
+    for (size_t i = 0; i < batch; i++) {
+        data.push_back(Matrix<double>::initializeRandom(64, 1));
+        target.push_back(Matrix<double>::initializeRandom(1, 1));
+    }
+    Matrix<double> X = NeuralNetwork<double>::stack(data), Y = NeuralNetwork<double>::stack(target);
+
+    // Batched gradients have to match the per-sample ones
+    auto w = nn.workspace(batch);
+    nn.forward(X, w);
+    nn.backward(Y, w);
+    vector<Matrix<double>> nabla_b, nabla_w;
+    for (unsigned int i = 0; i < nn.weights.size(); i++) {
+        nabla_b.push_back(Matrix<double>(nn.biases[i].rows, 1));
+        nabla_w.push_back(Matrix<double>(nn.weights[i].rows, nn.weights[i].columns));
+    }
+    for (size_t i = 0; i < batch; i++)
+        nn.updateNablas(data[i], target[i], nabla_b, nabla_w);
+    double error = 0;
+    for (unsigned int i = 0; i < nn.weights.size(); i++) {
+        for (size_t j = 0; j < nabla_w[i].size(); j++)
+            error = max(error, abs(nabla_w[i][j] - w.nablaW[i][j]));
+        for (size_t j = 0; j < nabla_b[i].size(); j++)
+            error = max(error, abs(nabla_b[i][j] - w.nablaB[i][j]));
+    }
+    cout << "Max gradient difference: " << error << endl;
+
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < batches; i++)
+        nn.updateBatchPerSample(data, target, 0.01);
+    double perSample = batch * batches / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    for (size_t i = 0; i < batches; i++)
+        nn.updateBatch(X, Y, 0.01, w);
+    double batched = batch * batches / chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Per-sample updateNablas: " << perSample << " samples/sec" << endl;
+    cout << "Batched GEMM: " << batched << " samples/sec (" << batched / perSample << "x)" << endl;
+
+    // Learn y = sum(x) / 64 as a sanity check
+    Matrix<double> trainX = Matrix<double>::initializeRandom(4096, 64), trainY(4096, 1);
+    for (size_t i = 0; i < 4096; i++) {
+        double sum = 0;
+        for (size_t j = 0; j < 64; j++)
+            sum += trainX[i * 64 + j];
+        trainY[i] = sum / 64;
+    }
+    auto before = nn.evaluateBatch(trainX) - trainY;
+    nn.train(trainX, trainY, 20, 32, 0.05, false);
+    auto after = nn.evaluateBatch(trainX) - trainY;
+    double mseBefore = 0, mseAfter = 0;
+    for (size_t i = 0; i < 4096; i++) {
+        mseBefore += before[i] * before[i] / 4096;
+        mseAfter += after[i] * after[i] / 4096;
+    }
+    cout << "MSE before " << mseBefore << ", after " << mseAfter << endl;
+    delete s; delete l;
+}